@@ -14,6 +14,9 @@
 
 #define LIBJSON_ERRBUF_SiZE 1024
 
+// Largest chunk of string value passed to json_sax_handler.string_chunk
+#define LIBJSON_SAX_CHUNK_SIZE (1 << 16)
+
 /**
  * @brief Opaque JSON structure
  *
@@ -22,12 +25,26 @@
  */
 struct json;
 
+struct json_arena;
+
 struct json_key_value
 {
     char *key;          /**< Key string (for objects) */
     struct json *value; /**< JSON value associated with the key */
 };
 
+/**
+ * @brief Options to control how JSON text is parsed
+ *
+ * Zero-initialize the structure to get the default behavior of json_read().
+ */
+struct json_read_options
+{
+    int lazy_numbers; /**< Keep numbers as their literal text and only convert them on access */
+    int lazy_strings; /**< Keep strings escaped as in the source and only decode them on access */
+    struct json_arena *arena; /**< Allocate the parsed value from this arena (see json_arena.h) */
+};
+
 ////////////////////////////////////
 // JSON Creation functions
 ////////////////////////////////////
@@ -74,8 +91,22 @@ struct json *__json_object_macro(struct json_key_value elements[]);
  * @brief Copies a JSON value
  * @param json JSON value to copy
  * @return A new JSON value that is a copy of the original
- * @note The returned value is a deep copy, meaning all nested structures are also copied.
- *       The caller is responsible for freeing the returned value using json_free().
+ * @note Copying an array or object that only holds strings, numbers,
+ *      booleans and nulls takes constant time: the copy shares its contents
+ *      with the original, with atomic reference counts, and the first of
+ *      them to be modified copies them then. Nested arrays and objects get
+ *      nodes of their own in the copy, each sharing its scalars in the same
+ *      way, so that the values obtained from the copy and from the original
+ *      can be modified independently. Copying a nested value therefore
+ *      takes time proportional to the number of arrays and objects it holds
+ *      plus the number of entries of those holding arrays or objects, with
+ *      an atomic reference count update for each entry that is a string or
+ *      number node. Only arrays and objects that hold scalars alone are
+ *      shared without being walked. Strings and numbers are never modified
+ *      and stay shared. Copies can be used and freed by other threads than
+ *      the original.
+ * @note Values of an arena or of a document are copied at once.
+ *      The caller is responsible for freeing the returned value using json_free().
  * @see json_free()
  */
 struct json *json_copy(struct json *json);
@@ -146,6 +177,8 @@ int json_array_length(struct json *array);
 
 /**
  * @brief Gets the value at a specific index in a JSON array
+ * @note Numbers are stored inline in arrays and objects. The first access to
+ *      one allocates its node, which the container owns from then on.
  * @param array JSON array to query
  * @param index Index of the element to retrieve
  * @return The JSON value at the specified index, or NULL if index is out of bounds
@@ -166,6 +199,25 @@ double json_double_value(const struct json *node);
  */
 int json_int_value(const struct json *node);
 
+/**
+ * @brief Gets the value of a JSON number as a 64-bit integer
+ * @note Numbers read with lazy_numbers are converted from their literal text,
+ *      so integers beyond 2^53 keep their exact value.
+ * @param node JSON value to query
+ * @return The integer value stored in the JSON number
+ */
+long long json_int64_value(const struct json *node);
+
+/**
+ * @brief Gets the literal text of a JSON number
+ * @param node JSON value to query
+ * @return The number exactly as it appeared in the source when read with
+ *      lazy_numbers, or NULL if the number has no literal text. The string is
+ *      owned by the node.
+ * @see struct json_read_options
+ */
+const char *json_number_text(const struct json *node);
+
 /**
  * @brief Gets the value of a JSON string
  * @note The returned string is a copy of the original string stored in the JSON value.
@@ -175,6 +227,18 @@ int json_int_value(const struct json *node);
  */
 const char *json_string_value(const struct json *node);
 
+/**
+ * @brief Gets the value of a JSON string without copying it
+ * @note Strings read with lazy_strings are decoded on the first call and the
+ *      decoded text is kept in the node. That first call must not race with
+ *      other accesses to the same node.
+ * @param node JSON value to query
+ * @return The string value stored in the JSON string, owned by the node and
+ *      valid until the node is freed
+ * @see json_string_value()
+ */
+const char *json_string_borrow(const struct json *node);
+
 ////////////////////////////////////
 // JSON Manipulation functions
 ////////////////////////////////////
@@ -189,6 +253,7 @@ void json_object_set(struct json *object, const char *key, struct json *value);
 
 /**
  * @brief Gets a value by key from a JSON object
+ * @note Like json_array_get(), the first access to a number allocates its node.
  * @param object JSON object to query
  * @param key Key string to look up
  * @return The associated JSON value, or NULL if key not found
@@ -203,6 +268,112 @@ struct json *json_object_get(const struct json *object, const char *key);
  */
 struct json *json_object_remove(struct json *object, const char *key);
 
+/**
+ * @brief Sets a key-value pair in a JSON object, with a key of known length
+ * @note Keys may contain NUL bytes, as JSON allows with the \u0000 escape.
+ * @param object JSON object to modify
+ * @param key Key bytes (will be copied)
+ * @param length Length of the key in bytes
+ * @param value JSON value to associate with the key
+ */
+void json_object_set_n(struct json *object, const char *key, size_t length, struct json *value);
+
+/**
+ * @brief Sets a number in a JSON object, stored inline without a node
+ * @param object JSON object to modify
+ * @param key Key string (will be copied)
+ * @param value Number to associate with the key
+ */
+void json_object_set_number(struct json *object, const char *key, double value);
+
+/**
+ * @brief Gets a number by key from a JSON object without getting its node
+ * @note Unlike json_object_get(), this never allocates, even for a number
+ *      stored inline that has not been accessed yet.
+ * @param object JSON object to query
+ * @param key Key string to look up
+ * @param value Where to store the number, unless NULL
+ * @return 1 if the key holds a number, 0 if it is missing or holds another value
+ */
+int json_object_get_number(const struct json *object, const char *key, double *value);
+
+/**
+ * @brief Gets a value by key from a JSON object, with a key of known length
+ * @param object JSON object to query
+ * @param key Key bytes to look up
+ * @param length Length of the key in bytes
+ * @return The associated JSON value, or NULL if key not found
+ */
+struct json *json_object_get_n(const struct json *object, const char *key, size_t length);
+
+/**
+ * @brief Removes a key-value pair from a JSON object, with a key of known length
+ * @param object JSON object to modify
+ * @param key Key bytes to remove
+ * @param length Length of the key in bytes
+ * @return The removed JSON value, or NULL if key not found. Caller should free the returned value if necessary.
+ */
+struct json *json_object_remove_n(struct json *object, const char *key, size_t length);
+
+/**
+ * @brief Key hashed once, to look it up in many objects
+ *
+ * A key made with json_key_make() or json_key_make_n() refers to the key text
+ * without copying it, so the text must outlive it. Looking a key up through
+ * it neither measures nor hashes the text again.
+ */
+struct json_key
+{
+    const char *key;         /**< Key text, which may contain NUL bytes */
+    size_t length;           /**< Length of the key in bytes */
+    unsigned long long hash; /**< Hash of the key (private) */
+};
+
+/**
+ * @brief Makes a precomputed key from a string
+ * @param key Key string, which must outlive the returned key
+ * @return The key, to pass to json_object_get_key() and json_object_set_key()
+ */
+struct json_key json_key_make(const char *key);
+
+/**
+ * @brief Makes a precomputed key from a slice of known length
+ * @param key Key, which need not be NUL-terminated and must outlive the
+ *      returned key
+ * @param length Length of the key in bytes
+ * @return The key, to pass to json_object_get_key() and json_object_set_key()
+ */
+struct json_key json_key_make_n(const char *key, size_t length);
+
+/**
+ * @brief Gets a value by precomputed key from a JSON object
+ * @note Like json_array_get(), the first access to a number allocates its node.
+ * @param object JSON object to query
+ * @param key Key made with json_key_make() or json_key_make_n()
+ * @return The JSON value associated with the key, or NULL if key not found
+ */
+struct json *json_object_get_key(const struct json *object, const struct json_key *key);
+
+/**
+ * @brief Gets a number by precomputed key from a JSON object without getting
+ *      its node
+ * @see json_object_get_number()
+ * @param object JSON object to query
+ * @param key Key made with json_key_make() or json_key_make_n()
+ * @param value Where to store the number, unless NULL
+ * @return 1 if the key holds a number, 0 if it is missing or holds another value
+ */
+int json_object_get_key_number(const struct json *object, const struct json_key *key, double *value);
+
+/**
+ * @brief Sets a key-value pair in a JSON object by precomputed key
+ * @param object JSON object to modify
+ * @param key Key made with json_key_make() or json_key_make_n() (its text
+ *      will be copied)
+ * @param value JSON value to associate with the key
+ */
+void json_object_set_key(struct json *object, const struct json_key *key, struct json *value);
+
 /**
  * @brief Gets the number of key-value pairs in a JSON object
  * @param object JSON object to query
@@ -217,6 +388,115 @@ int json_object_length(struct json *object);
  */
 void json_array_push(struct json *array, struct json *value);
 
+/**
+ * @brief Adds a number to the end of a JSON array, stored inline without a node
+ * @param array JSON array to modify
+ * @param value Number to add to the array
+ */
+void json_array_push_number(struct json *array, double value);
+
+/**
+ * @brief Gets the number at a specific index in a JSON array without getting
+ *      its node
+ * @note Unlike json_array_get(), this never allocates, even for a number
+ *      stored inline that has not been accessed yet.
+ * @param array JSON array to query
+ * @param index Index of the element to read
+ * @param value Where to store the number, unless NULL
+ * @return 1 if the element is a number, 0 if index is out of bounds or the
+ *      element is another value
+ */
+int json_array_get_number(const struct json *array, int index, double *value);
+
+////////////////////////////////////
+// JSON Iteration functions
+////////////////////////////////////
+
+/**
+ * @brief Iterator over the elements of a JSON array
+ *
+ * Iterators are plain structures, meant to be declared on the stack, and
+ * iterating never allocates, except for the node of a number on its first
+ * access, see json_array_get(). Iterating only reads the array, so several
+ * threads may iterate over the same array at once. Elements may be modified
+ * while iterating, but not the array itself.
+ */
+struct json_array_iter
+{
+    struct json *value;       /**< Current element */
+    int index;                /**< Index of the current element */
+    const struct json *array; /**< Array iterated (private) */
+};
+
+/**
+ * @brief Iterator over the keys of a JSON object, in insertion order
+ *
+ * Like struct json_array_iter, values may be modified while iterating, but
+ * keys must not be set nor removed.
+ */
+struct json_object_iter
+{
+    const char *key;           /**< Current key, which may contain NUL bytes */
+    size_t key_length;         /**< Length of the current key in bytes */
+    struct json *value;        /**< Value of the current key */
+    const struct json *object; /**< Object iterated (private) */
+    size_t position;           /**< Position of the next entry (private) */
+};
+
+/**
+ * @brief Starts iterating over a JSON array
+ * @param iter Iterator to initialize
+ * @param array JSON array to iterate, which yields no element if it is not an array
+ */
+void json_array_iter_init(struct json_array_iter *iter, const struct json *array);
+
+/**
+ * @brief Moves an iterator to the next element of its array
+ * @param iter Iterator to move
+ * @return 1 if iter->value holds the next element, 0 at the end of the array
+ *      or if a number could not be allocated
+ */
+int json_array_iter_next(struct json_array_iter *iter);
+
+/**
+ * @brief Starts iterating over a JSON object
+ * @param iter Iterator to initialize
+ * @param object JSON object to iterate, which yields no key if it is not an object
+ */
+void json_object_iter_init(struct json_object_iter *iter, const struct json *object);
+
+/**
+ * @brief Moves an iterator to the next key of its object
+ * @param iter Iterator to move
+ * @return 1 if iter->key and iter->value hold the next key and its value, 0
+ *      at the end of the object or if a number could not be allocated
+ */
+int json_object_iter_next(struct json_object_iter *iter);
+
+/**
+ * @brief Loops over the elements of a JSON array
+ *
+ * @code
+ * struct json_array_iter iter;
+ * JSON_ARRAY_FOREACH(iter, array)
+ *     printf("%d: %s\n", iter.index, json_string_borrow(iter.value));
+ * @endcode
+ */
+#define JSON_ARRAY_FOREACH(iter, array) \
+    for (json_array_iter_init(&(iter), (array)); json_array_iter_next(&(iter));)
+
+/**
+ * @brief Loops over the keys and values of a JSON object
+ *
+ * @code
+ * struct json_object_iter iter;
+ * JSON_OBJECT_FOREACH(iter, object)
+ *     printf("%s: %d\n", iter.key, json_int_value(iter.value));
+ * @endcode
+ */
+#define JSON_OBJECT_FOREACH(iter, object) \
+    for (json_object_iter_init(&(iter), (object)); json_object_iter_next(&(iter));)
+
 ////////////////////////////////////
 // JSON Serialization functions
 ////////////////////////////////////
@@ -240,6 +520,16 @@ int json_write(struct json *node, FILE *out);
  */
 struct json *json_read(FILE *in, char *errbuf);
 
+/**
+ * @brief Reads a JSON value from a file stream with parsing options
+ * @param in File stream to read from
+ * @param options Parsing options (optional). NULL behaves like json_read().
+ * @param errbuf Buffer to store error messages (optional).
+ * @return The parsed JSON value, or NULL on parsing error
+ * @see json_read()
+ */
+struct json *json_read_opts(FILE *in, const struct json_read_options *options, char *errbuf);
+
 /**
  * @brief Reads a JSON value from a string
  * @param json_string The JSON string to parse
@@ -251,6 +541,322 @@ struct json *json_read(FILE *in, char *errbuf);
  */
 struct json *json_read_string(const char *json_string, char *errbuf);
 
+/**
+ * @brief Reads a JSON value from a string with parsing options
+ * @param json_string The JSON string to parse
+ * @param options Parsing options (optional). NULL behaves like json_read_string().
+ * @param errbuf Buffer to store error messages (optional).
+ * @return The parsed JSON value, or NULL on parsing error
+ * @see json_read_opts()
+ */
+struct json *json_read_string_opts(const char *json_string, const struct json_read_options *options, char *errbuf);
+
+////////////////////////////////////
+// JSON Stream reading functions
+////////////////////////////////////
+
+/**
+ * @brief Opaque reader for streams holding several top-level JSON values
+ *
+ * Values may be concatenated (`{..}{..}`), separated by whitespace (e.g.
+ * newline-delimited JSON) or prefixed by the RFC 7464 record separator
+ * (0x1E) of JSON text sequences.
+ */
+struct json_reader;
+
+/**
+ * @brief Reads the next top-level JSON value from a file stream
+ * @note Whitespace and record separators before the value are skipped. No
+ *      byte after the end of the value is consumed, so the next call starts
+ *      exactly where this one stopped.
+ * @param in File stream to read from
+ * @param errbuf Buffer to store error messages (optional).
+ * @return The parsed JSON value, or NULL at the end of the stream or on
+ *      parsing error. Use json_error() to tell both cases apart.
+ * @see json_reader_next()
+ */
+struct json *json_read_next(FILE *in, char *errbuf);
+
+/**
+ * @brief Creates a reader for the values of a file stream
+ * @param in File stream to read from. It is not closed by the reader.
+ * @param options Parsing options (optional), copied into the reader.
+ * @return A new reader, or NULL on allocation failure
+ * @see json_reader_free()
+ */
+struct json_reader *json_reader_new(FILE *in, const struct json_read_options *options);
+
+/**
+ * @brief Reads the next JSON value of the stream
+ * @note Inside an array entered with json_reader_enter_array(), the next
+ *      element of that array is read instead of a top-level value.
+ * @param reader Reader to read from
+ * @param errbuf Buffer to store error messages (optional).
+ * @return The parsed JSON value, or NULL at the end of the stream, at the
+ *      end of the entered array or on parsing error. Use json_error() to
+ *      tell them apart from each other, and json_reader_depth() to tell the
+ *      end of an array from the end of the stream. After an error the stream
+ *      position is wherever the parser stopped.
+ * @see json_read_next()
+ */
+struct json *json_reader_next(struct json_reader *reader, char *errbuf);
+
+/**
+ * @brief Enters the array that comes next in the stream
+ *
+ * Subsequent calls to json_reader_next() return its elements one at a time,
+ * fully built, so that each one can be freed before the next one is parsed.
+ * Memory use is then bounded by the largest element rather than by the
+ * array. Entering an element of an entered array iterates over a nested
+ * array.
+ *
+ * @param reader Reader to read from
+ * @param errbuf Buffer to store error messages (optional).
+ * @return Non-zero if an array was entered, 0 if the next value is not an
+ *      array or on parsing error
+ */
+int json_reader_enter_array(struct json_reader *reader, char *errbuf);
+
+/**
+ * @brief Gets the number of entered arrays the reader is inside of
+ * @param reader Reader to query
+ * @return 0 when reading top-level values
+ */
+int json_reader_depth(const struct json_reader *reader);
+
+/**
+ * @brief Gets the number of bytes consumed by a reader
+ * @param reader Reader to query
+ * @return The offset right after the last value read
+ */
+long long json_reader_offset(const struct json_reader *reader);
+
+/**
+ * @brief Position of a reader from which parsing can be resumed
+ *
+ * A checkpoint only holds plain integers, so it can be saved as is (e.g. to
+ * a file) and restored by another process reading the same data. Since only
+ * arrays can be entered, the container stack is fully described by its depth
+ * and by whether the innermost array already had an element read.
+ */
+struct json_checkpoint
+{
+    long long offset; /**< Bytes consumed since the reader was created */
+    int line;         /**< Line reached, used in error messages */
+    int column;       /**< Column reached, used in error messages */
+    int depth;        /**< Number of entered arrays */
+    int expect_comma; /**< Whether an element of the innermost entered array was read */
+};
+
+/**
+ * @brief Takes a checkpoint of a reader between two values
+ * @param reader Reader to query
+ * @param checkpoint Receives the current position of the reader
+ * @see json_reader_restore()
+ */
+void json_reader_checkpoint(const struct json_reader *reader, struct json_checkpoint *checkpoint);
+
+/**
+ * @brief Resumes reading from a checkpoint
+ * @note The file stream must be seekable and hold the same data from the
+ *      position the reader was created at. The checkpoint may come from
+ *      another reader, e.g. one of a previous run of an import job.
+ * @param reader Reader to move
+ * @param checkpoint Position to resume reading from
+ * @param errbuf Buffer to store error messages (optional).
+ * @return Non-zero on success, 0 if the stream could not be repositioned
+ * @see json_reader_checkpoint()
+ */
+int json_reader_restore(struct json_reader *reader, const struct json_checkpoint *checkpoint, char *errbuf);
+
+/**
+ * @brief Frees a reader, leaving its file stream open
+ * @param reader Reader to free
+ */
+void json_reader_free(struct json_reader *reader);
+
+/**
+ * @brief Reasons for skipping a record of a newline-delimited stream
+ */
+enum json_ndjson_failure
+{
+    JSON_NDJSON_SYNTAX,        /**< The record is not valid JSON */
+    JSON_NDJSON_TRAILING_DATA, /**< A valid value is followed by more data on the same line */
+    JSON_NDJSON_OUT_OF_MEMORY, /**< The record could not be stored */
+    JSON_NDJSON_FAILURE_COUNT  /**< Number of failure reasons */
+};
+
+/**
+ * @brief Counters of a newline-delimited JSON reader
+ */
+struct json_ndjson_stats
+{
+    long long records;  /**< Records parsed successfully */
+    long long failures; /**< Records skipped because they could not be parsed */
+    long long bytes;    /**< Bytes consumed, including skipped records */
+    long long lines;    /**< Lines consumed, including blank ones */
+    long long failure_reasons[JSON_NDJSON_FAILURE_COUNT]; /**< Failures by reason */
+};
+
+/**
+ * @brief Callback reporting a skipped record
+ * @param offset Offset of the first byte of the record in the stream
+ * @param line Line of the record, starting at 1
+ * @param reason Why the record was skipped
+ * @param message Description of the error
+ * @param ctx Context given to json_ndjson_reader_new()
+ */
+typedef void (*json_ndjson_error_func)(long long offset, long long line, enum json_ndjson_failure reason, const char *message, void *ctx);
+
+/**
+ * @brief Opaque error-tolerant reader for newline-delimited JSON streams
+ *
+ * Each line holds one record. A record that cannot be parsed is reported,
+ * counted and skipped, and reading carries on with the next line.
+ */
+struct json_ndjson_reader;
+
+/**
+ * @brief Creates a reader for a newline-delimited JSON stream
+ * @param in File stream to read from. It is not closed by the reader.
+ * @param options Parsing options (optional), copied into the reader.
+ * @param on_error Callback for skipped records (optional)
+ * @param ctx Context passed to the callback
+ * @return A new reader, or NULL on allocation failure
+ * @see json_ndjson_reader_free()
+ */
+struct json_ndjson_reader *json_ndjson_reader_new(FILE *in, const struct json_read_options *options, json_ndjson_error_func on_error, void *ctx);
+
+/**
+ * @brief Reads the next valid record, skipping invalid ones
+ * @param reader Reader to read from
+ * @return The parsed record, or NULL at the end of the stream or when the
+ *      stream could not be read. Use json_ndjson_reader_error() to tell both
+ *      cases apart.
+ */
+struct json *json_ndjson_reader_next(struct json_ndjson_reader *reader);
+
+/**
+ * @brief Gets why a newline-delimited JSON reader stopped before the end of
+ *      its stream
+ * @param reader Reader to query
+ * @return A description of the read error, owned by the reader, or NULL if
+ *      no read error occurred
+ */
+const char *json_ndjson_reader_error(const struct json_ndjson_reader *reader);
+
+/**
+ * @brief Gets the counters of a newline-delimited JSON reader
+ * @param reader Reader to query
+ * @return The counters, owned by the reader and updated on every read
+ */
+const struct json_ndjson_stats *json_ndjson_reader_stats(const struct json_ndjson_reader *reader);
+
+/**
+ * @brief Frees a newline-delimited JSON reader, leaving its stream open
+ * @param reader Reader to free
+ */
+void json_ndjson_reader_free(struct json_ndjson_reader *reader);
+
+/**
+ * @brief Result of reading from a source that may not have data available
+ */
+enum json_read_status
+{
+    JSON_READ_VALUE, /**< A value was read */
+    JSON_READ_AGAIN, /**< No complete value is available yet, retry once more input is ready */
+    JSON_READ_EOF,   /**< The stream ended cleanly */
+    JSON_READ_ERROR  /**< A read or parsing error occurred, described in the error buffer */
+};
+
+/**
+ * @brief Opaque reader for the values received on a file descriptor
+ *
+ * Input is read with large read() calls into an internal ring buffer, so the
+ * descriptor may be a non-blocking socket driven by an event loop (e.g.
+ * epoll). Values are delimited like in json_reader_next().
+ */
+struct json_fd_reader;
+
+/**
+ * @brief Creates a reader for the values of a file descriptor
+ * @param fd Descriptor to read from. It is not closed by the reader.
+ * @param options Parsing options (optional), copied into the reader.
+ * @return A new reader, or NULL on allocation failure
+ * @see json_fd_reader_free()
+ */
+struct json_fd_reader *json_fd_reader_new(int fd, const struct json_read_options *options);
+
+/**
+ * @brief Reads the next top-level JSON value from a file descriptor
+ * @note JSON_READ_AGAIN is only returned once read() reports EAGAIN, which
+ *      makes the reader usable with edge-triggered epoll: keep calling until
+ *      it is returned, then wait for readiness. Buffered input is kept, so
+ *      the next call resumes where this one stopped. After a parsing error
+ *      the reader continues with the value that follows the invalid one.
+ * @param reader Reader to read from
+ * @param dest Receives the parsed value when JSON_READ_VALUE is returned
+ * @param errbuf Buffer to store error messages (optional).
+ * @return The status of the read
+ */
+enum json_read_status json_fd_reader_next(struct json_fd_reader *reader, struct json **dest, char *errbuf);
+
+/**
+ * @brief Gets the number of bytes consumed by a file descriptor reader
+ * @param reader Reader to query
+ * @return The offset right after the last value returned
+ */
+long long json_fd_reader_offset(const struct json_fd_reader *reader);
+
+/**
+ * @brief Frees a file descriptor reader, leaving its descriptor open
+ * @param reader Reader to free
+ */
+void json_fd_reader_free(struct json_fd_reader *reader);
+
+////////////////////////////////////
+// JSON Event reading functions
+////////////////////////////////////
+
+/**
+ * @brief Callbacks receiving the parsing events of json_sax_read()
+ *
+ * Every callback is optional. Returning 0 from a callback stops parsing.
+ */
+struct json_sax_handler
+{
+    int (*null_value)(void *ctx);                  /**< A null value */
+    int (*boolean_value)(int value, void *ctx);    /**< A true or false value */
+    int (*number_value)(const char *text, void *ctx); /**< A number, as its literal text */
+    /**
+     * A piece of a string value, already unescaped. Strings arrive in chunks
+     * of at most LIBJSON_SAX_CHUNK_SIZE bytes, possibly splitting UTF-8
+     * sequences, and the last chunk of each string has last set.
+     */
+    int (*string_chunk)(const char *chunk, size_t length, int last, void *ctx);
+    int (*key)(const char *key, void *ctx);        /**< The key of the next object member */
+    int (*start_object)(void *ctx);                /**< The start of an object */
+    int (*end_object)(void *ctx);                  /**< The end of an object */
+    int (*start_array)(void *ctx);                 /**< The start of an array */
+    int (*end_array)(void *ctx);                   /**< The end of an array */
+};
+
+/**
+ * @brief Reads a JSON value from a file stream as a sequence of events
+ *
+ * No document is built, and string values are streamed in bounded chunks,
+ * so memory use does not depend on the size of the input, even for huge
+ * string values.
+ *
+ * @param in File stream to read from
+ * @param handler Callbacks receiving the events
+ * @param ctx Context passed to the callbacks
+ * @param errbuf Buffer to store error messages (optional).
+ * @return Non-zero if the whole value was read, 0 on parsing error or when a
+ *      callback stopped parsing
+ */
+int json_sax_read(FILE *in, const struct json_sax_handler *handler, void *ctx, char *errbuf);
+
 /**
  * @brief Returns the last error message from parsing
  * @param errbuf Buffer containing the error message. If NULL, uses a default
@@ -260,4 +866,36 @@ struct json *json_read_string(const char *json_string, char *errbuf);
  */
 const char *json_error(char *errbuf);
 
+////////////////////////////////////
+// Memory allocation functions
+////////////////////////////////////
+
+/**
+ * @brief Allocation function of a custom allocator, with the semantics of malloc()
+ */
+typedef void *(*json_malloc_func)(size_t size, void *ctx);
+
+/**
+ * @brief Reallocation function of a custom allocator, with the semantics of realloc()
+ */
+typedef void *(*json_realloc_func)(void *ptr, size_t size, void *ctx);
+
+/**
+ * @brief Release function of a custom allocator, never called with NULL
+ */
+typedef void (*json_free_func)(void *ptr, void *ctx);
+
+/**
+ * @brief Sets the allocator used for all the memory of the library
+ * @note Set it before any other call: memory must be released by the
+ *      allocator that provided it. Strings returned to the caller, like those
+ *      of json_string_value() and json_error(), come from this allocator too.
+ *      Arenas can have an allocator of their own, see json_arena.h.
+ * @param malloc_fn Allocation function, or NULL to restore the C library functions
+ * @param realloc_fn Reallocation function, or NULL to restore the C library functions
+ * @param free_fn Release function, or NULL to restore the C library functions
+ * @param ctx Context passed to the functions
+ */
+void json_set_allocator(json_malloc_func malloc_fn, json_realloc_func realloc_fn, json_free_func free_fn, void *ctx);
+
 #endif // LIBJSON_JSON_H
\ No newline at end of file
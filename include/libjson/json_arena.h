@@ -0,0 +1,104 @@
+#ifndef LIBJSON_JSON_ARENA_H
+#define LIBJSON_JSON_ARENA_H
+
+#include "json.h"
+#include <stddef.h>
+
+/**
+ * @file json_arena.h
+ * @brief Values allocated from an arena and released all at once
+ *
+ * Values parsed with the arena option or built with the functions below take
+ * all of their memory from the chunks of the arena: nodes, strings, keys and
+ * the storage of arrays and objects. json_free() does nothing for them, and
+ * they are all released by json_arena_reset() or json_arena_free() in time
+ * proportional to the number of chunks.
+ *
+ * Arrays and objects of an arena keep allocating from it when they grow, and
+ * should only be given values of the same arena: other values added to them
+ * are not freed along with the arena. json_copy() of an arena value returns a
+ * value that does not depend on the arena. Reading a number held by an array
+ * or object of an arena allocates its node from the arena, so an arena must
+ * not be used by several threads at once, even only to read its values.
+ */
+
+/**
+ * @brief Flags of a new arena
+ */
+enum json_arena_flags
+{
+    JSON_ARENA_HUGE_PAGES = 1 /**< Map the chunks with transparent huge pages where supported */
+};
+
+/**
+ * @brief Chunks from which values are allocated
+ */
+struct json_arena;
+
+/**
+ * @brief Creates an arena
+ * @param chunk_size Size of the chunks in bytes, or 0 for the default of 1MB.
+ *      Sizes below 1KB are rounded up to 1KB.
+ * @param flags Bitwise or of enum json_arena_flags
+ * @return The new arena, or NULL if out of memory
+ */
+struct json_arena *json_arena_new(size_t chunk_size, int flags);
+
+/**
+ * @brief Creates an arena whose chunks come from the given allocator
+ * @note Only the memory of the arena comes from this allocator, which lets
+ *      each document use its own pool. Values copied out of the arena use the
+ *      allocator of the library, see json_set_allocator().
+ * @param chunk_size Size of the chunks in bytes, or 0 for the default of 1MB.
+ *      Sizes below 1KB are rounded up to 1KB.
+ * @param flags Bitwise or of enum json_arena_flags
+ * @param malloc_fn Allocation function, or NULL for the allocator of the library
+ * @param free_fn Release function, or NULL for the allocator of the library
+ * @param ctx Context passed to the functions
+ * @return The new arena, or NULL if out of memory
+ */
+struct json_arena *json_arena_new_allocator(size_t chunk_size, int flags, json_malloc_func malloc_fn, json_free_func free_fn, void *ctx);
+
+/**
+ * @brief Releases every value of an arena, keeping its first chunk for reuse
+ * @param arena Arena to reset
+ */
+void json_arena_reset(struct json_arena *arena);
+
+/**
+ * @brief Releases every value of an arena, and the arena itself
+ * @param arena Arena to free
+ */
+void json_arena_free(struct json_arena *arena);
+
+/**
+ * @brief Creates a JSON number in an arena
+ * @param arena Arena to allocate from
+ * @param value Numeric value
+ * @return The new JSON number, or NULL if out of memory
+ */
+struct json *json_arena_number(struct json_arena *arena, double value);
+
+/**
+ * @brief Creates a JSON string in an arena
+ * @param arena Arena to allocate from
+ * @param value String value (will be copied)
+ * @return The new JSON string, or NULL if out of memory
+ */
+struct json *json_arena_string(struct json_arena *arena, const char *value);
+
+/**
+ * @brief Creates an empty JSON array in an arena
+ * @param arena Arena to allocate from
+ * @return The new JSON array, or NULL if out of memory
+ */
+struct json *json_arena_array(struct json_arena *arena);
+
+/**
+ * @brief Creates an empty JSON object in an arena
+ * @param arena Arena to allocate from
+ * @return The new JSON object, or NULL if out of memory
+ */
+struct json *json_arena_object(struct json_arena *arena);
+
+#endif // LIBJSON_JSON_ARENA_H
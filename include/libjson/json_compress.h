@@ -0,0 +1,63 @@
+#ifndef LIBJSON_JSON_COMPRESS_H
+#define LIBJSON_JSON_COMPRESS_H
+
+#include "json.h"
+#include <stdio.h>
+
+/**
+ * @file json_compress.h
+ * @brief Compressed input and output streams for the JSON manipulation library
+ *
+ * This header provides file streams that decompress or compress on the fly,
+ * so that every reading and writing function of the library works on
+ * compressed data without temporary files or external processes. gzip
+ * support requires zlib and zstd support requires libzstd at build time.
+ */
+
+/**
+ * @brief Compression formats of a stream
+ */
+enum json_compression
+{
+    JSON_COMPRESSION_AUTO, /**< Detected from the data when reading, from the file extension when writing */
+    JSON_COMPRESSION_NONE, /**< Plain, uncompressed data */
+    JSON_COMPRESSION_GZIP, /**< gzip, possibly with several concatenated members */
+    JSON_COMPRESSION_ZSTD  /**< Zstandard, possibly with several concatenated frames */
+};
+
+/**
+ * @brief Tests if a compression format is available in this build
+ * @param compression Compression format to test
+ * @return Non-zero if streams in that format can be opened
+ */
+int json_compression_supported(enum json_compression compression);
+
+/**
+ * @brief Opens a compressed file as a stream of its uncompressed data
+ * @note When reading, decompression runs on a helper thread that fills large
+ *      blocks ahead of the parser.
+ * @param path Path of the file to open
+ * @param mode "r" to decompress the file, or "w" to compress what is written
+ * @param compression Compression format of the file
+ * @return A stream to use with any reading or writing function and to close
+ *      with fclose(), or NULL with errno set. errno is ENOTSUP when the
+ *      format is not available in this build.
+ * @see json_compressed_wrap()
+ */
+FILE *json_compressed_fopen(const char *path, const char *mode, enum json_compression compression);
+
+/**
+ * @brief Wraps a stream of compressed data as a stream of its uncompressed data
+ * @note Useful for pipes and sockets. Closing the returned stream with
+ *      fclose() also closes the wrapped one.
+ * @param raw Stream of compressed data
+ * @param mode "r" to decompress the stream, or "w" to compress what is written
+ * @param compression Compression format of the stream. JSON_COMPRESSION_AUTO
+ *      means no compression when writing.
+ * @return A stream of uncompressed data, or NULL with errno set. On failure
+ *      the wrapped stream is left open.
+ * @see json_compressed_fopen()
+ */
+FILE *json_compressed_wrap(FILE *raw, const char *mode, enum json_compression compression);
+
+#endif // LIBJSON_JSON_COMPRESS_H
@@ -0,0 +1,78 @@
+#ifndef LIBJSON_JSON_DOCUMENT_H
+#define LIBJSON_JSON_DOCUMENT_H
+
+#include "json.h"
+#include <stddef.h>
+
+/**
+ * @file json_document.h
+ * @brief Incremental re-parsing of edited JSON and JSON5 text
+ *
+ * A document keeps the source span of every parsed value. When the text is
+ * edited, only the smallest value enclosing the edit is parsed again, and
+ * every other value is kept as it was, including its address.
+ */
+
+/**
+ * @brief Syntax of the text of a document
+ */
+enum json_syntax
+{
+    JSON_SYNTAX_JSON, /**< Standard JSON */
+    JSON_SYNTAX_JSON5 /**< JSON5, as read by json5_read() */
+};
+
+/**
+ * @brief Localized change of the text of a document
+ */
+struct json_edit
+{
+    size_t offset;          /**< Byte offset of the change in the previous text */
+    size_t removed;         /**< Number of bytes removed at offset */
+    size_t inserted_length; /**< Number of bytes inserted at offset in their place */
+};
+
+/**
+ * @brief Parsed text of a document along with the spans of its values
+ */
+struct json_document;
+
+/**
+ * @brief Parses a document
+ * @param text Text to parse, which does not need to be NUL-terminated
+ * @param length Length of the text in bytes
+ * @param syntax Syntax of the text
+ * @param errbuf Buffer to store error messages (optional)
+ * @return The new document, or NULL if the text could not be parsed
+ */
+struct json_document *json_document_parse(const char *text, size_t length, enum json_syntax syntax, char *errbuf);
+
+/**
+ * @brief Applies an edit to a document
+ * @note Values outside the smallest value enclosing the edit are reused, so
+ *      pointers to them stay valid. The value that is parsed again keeps its
+ *      address when it is an array or an object. When the new text is invalid
+ *      the document holds no value until a later edit makes it valid again.
+ * @param document Document to update
+ * @param edit Change from the previous text of the document
+ * @param text Complete text after the edit
+ * @param length Length of the text after the edit in bytes
+ * @param errbuf Buffer to store error messages (optional)
+ * @return 1 if the new text is valid, 0 otherwise
+ */
+int json_document_edit(struct json_document *document, const struct json_edit *edit, const char *text, size_t length, char *errbuf);
+
+/**
+ * @brief Gets the value of a document
+ * @param document Document to query
+ * @return The value, owned by the document, or NULL if the last text was invalid
+ */
+struct json *json_document_root(const struct json_document *document);
+
+/**
+ * @brief Frees a document along with its value
+ * @param document Document to free
+ */
+void json_document_free(struct json_document *document);
+
+#endif // LIBJSON_JSON_DOCUMENT_H
@@ -0,0 +1,181 @@
+#ifndef LIBJSON_JSON_PERSISTENT_H
+#define LIBJSON_JSON_PERSISTENT_H
+
+#include "json.h"
+#include <stddef.h>
+
+/**
+ * @file json_persistent.h
+ * @brief Immutable JSON values whose versions share their structure
+ *
+ * A persistent value is never modified: setting, pushing or removing returns
+ * a new version, which shares everything but the path to the change with the
+ * previous one. Objects are hash array mapped tries and arrays are tries of
+ * 32 elements wide chunks, so that each version only costs a few nodes, and
+ * keeping many versions of a large document costs little more than one.
+ *
+ * Versions are reference counted with atomic counts, and can be read and
+ * freed by several threads at once. Functions returning a version return a
+ * new reference, which the caller frees with json_persistent_free(), while
+ * the versions given to them are left to the caller. Values given to set and
+ * push functions are taken over by the new version, and freed on failure.
+ *
+ * Keys of objects are kept in insertion order, like those of struct json.
+ */
+
+/**
+ * @brief Version of an immutable JSON value
+ */
+struct json_persistent;
+
+/**
+ * @brief Creates a persistent value from a JSON value
+ * @note Arrays and objects are converted in time proportional to their size,
+ *      while strings and numbers are shared with the value, see json_copy().
+ * @param value JSON value to convert, which is left unchanged
+ * @return The new persistent value, or NULL if value is NULL or out of memory
+ */
+struct json_persistent *json_persistent_from(const struct json *value);
+
+/**
+ * @brief Creates a JSON value from a persistent value
+ * @param value Persistent value to convert
+ * @return A new JSON value, to free with json_free(), or NULL if out of memory
+ */
+struct json *json_persistent_to_json(const struct json_persistent *value);
+
+/**
+ * @brief Creates an empty persistent array
+ * @return The new array, or NULL if out of memory
+ */
+struct json_persistent *json_persistent_array(void);
+
+/**
+ * @brief Creates an empty persistent object
+ * @return The new object, or NULL if out of memory
+ */
+struct json_persistent *json_persistent_object(void);
+
+/**
+ * @brief Takes a new reference to a persistent value, in constant time
+ * @param value Persistent value to copy
+ * @return The same value, to free with json_persistent_free()
+ */
+struct json_persistent *json_persistent_copy(const struct json_persistent *value);
+
+/**
+ * @brief Releases a reference to a persistent value
+ * @note Structure shared with other versions is only freed with the last one.
+ * @param value Persistent value to free
+ */
+void json_persistent_free(struct json_persistent *value);
+
+/**
+ * @brief Checks if a persistent value is an array
+ * @param value Persistent value to check
+ * @return 1 if the value is an array, 0 otherwise
+ */
+int json_persistent_is_array(const struct json_persistent *value);
+
+/**
+ * @brief Checks if a persistent value is an object
+ * @param value Persistent value to check
+ * @return 1 if the value is an object, 0 otherwise
+ */
+int json_persistent_is_object(const struct json_persistent *value);
+
+/**
+ * @brief Gets the JSON value of a persistent null, boolean, number or string
+ * @note The value must not be modified nor freed, and lives as long as the
+ *      persistent value.
+ * @param value Persistent value to query
+ * @return The JSON value, or NULL for arrays and objects
+ */
+const struct json *json_persistent_scalar(const struct json_persistent *value);
+
+/**
+ * @brief Gets the number of elements of an array or keys of an object
+ * @param value Persistent array or object
+ * @return The number of elements or keys, 0 for other values
+ */
+int json_persistent_length(const struct json_persistent *value);
+
+/**
+ * @brief Gets the value at an index of a persistent array
+ * @param array Persistent array to query
+ * @param index Index of the element
+ * @return The element, owned by the array, or NULL if index is out of bounds
+ */
+struct json_persistent *json_persistent_array_get(const struct json_persistent *array, int index);
+
+/**
+ * @brief Returns a version of an array with the value appended
+ * @param array Persistent array
+ * @param value Value to append, taken over by the new version
+ * @return The new version, or NULL if array is not an array or out of memory
+ */
+struct json_persistent *json_persistent_array_push(const struct json_persistent *array, struct json_persistent *value);
+
+/**
+ * @brief Returns a version of an array with the value at an index replaced
+ * @param array Persistent array
+ * @param index Index of the element to replace
+ * @param value New value of the element, taken over by the new version
+ * @return The new version, or NULL if index is out of bounds or out of memory
+ */
+struct json_persistent *json_persistent_array_set(const struct json_persistent *array, int index, struct json_persistent *value);
+
+/**
+ * @brief Returns a version of an array without its last element
+ * @param array Persistent array, which must not be empty
+ * @return The new version, or NULL if the array is empty or out of memory
+ */
+struct json_persistent *json_persistent_array_pop(const struct json_persistent *array);
+
+/**
+ * @brief Gets a value by key from a persistent object
+ * @param object Persistent object to query
+ * @param key Key string to look up
+ * @return The value, owned by the object, or NULL if key not found
+ */
+struct json_persistent *json_persistent_object_get(const struct json_persistent *object, const char *key);
+
+/**
+ * @brief Gets a value by key of known length from a persistent object
+ * @param object Persistent object to query
+ * @param key Key to look up, which may contain NUL bytes
+ * @param length Length of the key in bytes
+ * @return The value, owned by the object, or NULL if key not found
+ */
+struct json_persistent *json_persistent_object_get_n(const struct json_persistent *object, const char *key, size_t length);
+
+/**
+ * @brief Returns a version of an object with a key set
+ * @note A replaced key keeps its place in the order of the keys.
+ * @param object Persistent object
+ * @param key Key string (will be copied)
+ * @param value Value of the key, taken over by the new version
+ * @return The new version, or NULL if object is not an object or out of memory
+ */
+struct json_persistent *json_persistent_object_set(const struct json_persistent *object, const char *key, struct json_persistent *value);
+
+/**
+ * @brief Returns a version of an object with a key of known length set
+ * @param object Persistent object
+ * @param key Key to set, which may contain NUL bytes (will be copied)
+ * @param length Length of the key in bytes
+ * @param value Value of the key, taken over by the new version
+ * @return The new version, or NULL if object is not an object or out of memory
+ */
+struct json_persistent *json_persistent_object_set_n(const struct json_persistent *object, const char *key, size_t length, struct json_persistent *value);
+
+/**
+ * @brief Returns a version of an object without a key
+ * @param object Persistent object
+ * @param key Key string to remove
+ * @return The new version, which is the same as the object if it does not
+ *      have the key, or NULL if object is not an object or out of memory
+ */
+struct json_persistent *json_persistent_object_remove(const struct json_persistent *object, const char *key);
+
+#endif // LIBJSON_JSON_PERSISTENT_H
@@ -2,316 +2,622 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
-#define LIBJSON_HASH_TABLE_BUCKET_SIZE (1 << 8)
-#define LIBJSON_HASH_TABLE_KEY_MAX (1 << 8)
+// Objects with up to this many keys are searched linearly, without an index
+#define LIBJSON_HASH_TABLE_SMALL_MAX 8
+
+// Slots are probed by groups, whose control bytes are matched at once
+#define LIBJSON_HASH_TABLE_GROUP_SIZE 16
+#define LIBJSON_HASH_TABLE_MIN_CAPACITY LIBJSON_HASH_TABLE_GROUP_SIZE
+
+// Control byte of a slot: the low 7 bits of the hash when full, or one of these
+#define LIBJSON_HASH_TABLE_EMPTY 0x80
+#define LIBJSON_HASH_TABLE_DELETED 0xFE
 
 // Helper functions and structures
 
 struct hash_table_entry
 {
-    char key[LIBJSON_HASH_TABLE_KEY_MAX];
-    void *value;
+    uint64_t hash; // only computed once the table is indexed
+    size_t length;
+    char *key; // may contain NUL bytes, and is NUL-terminated past its length
+    json_cell value;
 };
 
+/**
+ * Object storage keeping its entries densely in insertion order. Small tables
+ * are searched linearly. Larger ones get an open addressing index of entry
+ * positions, and leave holes in the entries when keys are removed until they
+ * are compacted. Memory is only allocated with the first key, so an empty
+ * table is just this header.
+ */
 struct hash_table
 {
-    struct linked_list *bucket[LIBJSON_HASH_TABLE_BUCKET_SIZE];
+    struct hash_table_entry *entries; // holes have a NULL key
+    size_t count;                     // entries in use, holes included
+    size_t entries_capacity;
+    size_t size; // number of keys
+    int32_t *index;      // entry position of each slot, NULL while small
+    unsigned char *ctrl; // control byte of each slot, after the positions
+    size_t capacity;     // number of slots
+    size_t tombstones;   // deleted slots
+    char *keys;          // keys of a cloned table, in a single block
+    size_t keys_size;
+    unsigned refs;            // objects sharing the table, see hash_table_share()
+    unsigned char deep;       // has held values that cannot be shared, see hash_table_deep()
+    struct json_arena *arena; // holds the table, its keys and arrays, unless NULL
 };
 
-static void hash_table_init(struct hash_table *table)
+// Memory of a table comes from its arena when it has one, where it is only
+// released along with the arena
+
+static void *hash_table_alloc(const struct hash_table *table, size_t size)
+{
+    return table->arena ? json_arena_alloc(table->arena, size) : json_mem_alloc(size);
+}
+
+static void *hash_table_realloc(const struct hash_table *table, void *ptr, size_t old_size, size_t size)
+{
+    return table->arena ? json_arena_realloc(table->arena, ptr, old_size, size) : json_mem_realloc(ptr, size);
+}
+
+static void hash_table_mem_free(const struct hash_table *table, void *ptr)
 {
-    for (int i = 0; i < LIBJSON_HASH_TABLE_BUCKET_SIZE; i++)
+    if (!table->arena)
+        json_mem_free(ptr);
+}
+
+// Keys of a cloned table are released along with their block
+static void hash_table_key_free(const struct hash_table *table, char *key)
+{
+    if (table->keys && (uintptr_t)key - (uintptr_t)table->keys < table->keys_size)
+        return;
+    hash_table_mem_free(table, key);
+}
+
+uint64_t hash_table_hash(const char *key, size_t length)
+{
+    // FNV-1a, then a finalizer so that all bits depend on every byte
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < length; i++)
     {
-        table->bucket[i] = NULL;
+        hash ^= (unsigned char)key[i];
+        hash *= 0x100000001b3ULL;
     }
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return hash;
 }
 
-static int hash_table_hash(const char *key)
+// Bit i of the result is set when control byte i of the group equals byte
+static unsigned hash_table_group_match(const unsigned char *group, unsigned char byte)
 {
-    unsigned long hash = 5381;
-    int c;
-    while ((c = *key++))
+#ifdef __SSE2__
+    __m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+    return (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)byte)));
+#else
+    unsigned mask = 0;
+    for (int i = 0; i < LIBJSON_HASH_TABLE_GROUP_SIZE; i++)
+        mask |= (unsigned)(group[i] == byte) << i;
+    return mask;
+#endif
+}
+
+// Bit i of the result is set when slot i of the group is empty or deleted
+static unsigned hash_table_group_free(const unsigned char *group)
+{
+#ifdef __SSE2__
+    // Both special control bytes have their high bit set, full ones do not
+    return (unsigned)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)group));
+#else
+    unsigned mask = 0;
+    for (int i = 0; i < LIBJSON_HASH_TABLE_GROUP_SIZE; i++)
+        mask |= (unsigned)(group[i] >> 7) << i;
+    return mask;
+#endif
+}
+
+static int hash_table_lowest_bit(unsigned mask)
+{
+#if defined(__GNUC__)
+    return __builtin_ctz(mask);
+#else
+    int bit = 0;
+    while (!(mask & 1))
     {
-        hash = ((hash << 5) + hash) + c; // hash * 33 + c
+        mask >>= 1;
+        bit++;
     }
-    hash = abs(hash);
-    return hash % LIBJSON_HASH_TABLE_BUCKET_SIZE;
+    return bit;
+#endif
 }
 
-static int hash_table_key_equals_closure_func(struct hash_table_entry *entry, const char *key)
+// Returns the position of the key in a small table, or -1 if the key is absent
+static long hash_table_find_small(const struct hash_table *table, const char *key, size_t length)
 {
-    if (!entry || !key)
-        return 0;
+    for (size_t i = 0; i < table->count; i++)
+    {
+        const struct hash_table_entry *entry = &table->entries[i];
+        // Lengths and first bytes rule out most keys before comparing them
+        if (entry->length == length && (length == 0 || (entry->key[0] == key[0] && memcmp(entry->key, key, length) == 0)))
+            return (long)i;
+    }
+    return -1;
+}
 
-    return strcmp(entry->key, key) == 0;
+// Returns the slot of the key in an indexed table, or -1 if the key is absent
+static long hash_table_find(const struct hash_table *table, const char *key, size_t length, uint64_t hash)
+{
+    size_t groups = table->capacity / LIBJSON_HASH_TABLE_GROUP_SIZE;
+    size_t group = (hash >> 7) & (groups - 1);
+    unsigned char h2 = hash & 0x7F;
+    // Triangular probing visits every group once when their count is a power of two
+    for (size_t step = 1; step <= groups; step++)
+    {
+        const unsigned char *ctrl = table->ctrl + group * LIBJSON_HASH_TABLE_GROUP_SIZE;
+        unsigned mask = hash_table_group_match(ctrl, h2);
+        while (mask)
+        {
+            size_t slot = group * LIBJSON_HASH_TABLE_GROUP_SIZE + hash_table_lowest_bit(mask);
+            const struct hash_table_entry *entry = &table->entries[table->index[slot]];
+            if (entry->hash == hash && entry->length == length && memcmp(entry->key, key, length) == 0)
+                return (long)slot;
+            mask &= mask - 1;
+        }
+        // A key is never stored past a group that still has an empty slot
+        if (hash_table_group_match(ctrl, LIBJSON_HASH_TABLE_EMPTY))
+            return -1;
+        group = (group + step) & (groups - 1);
+    }
+    return -1;
 }
 
-static struct closure *hash_table_key_equals(const char *key)
+// Returns the position of the key in the entries, or -1 if the key is absent
+static long hash_table_lookup(const struct hash_table *table, const char *key, size_t length)
 {
-    return closure_new((closure_func)hash_table_key_equals_closure_func, (void *)key);
+    if (!table->index)
+        return hash_table_find_small(table, key, length);
+    long slot = hash_table_find(table, key, length, hash_table_hash(key, length));
+    return slot >= 0 ? table->index[slot] : -1;
 }
 
-struct hash_table *hash_table_new()
+// Returns the first empty or deleted slot on the probe sequence of a hash
+static size_t hash_table_free_slot(const struct hash_table *table, uint64_t hash)
 {
-    struct hash_table *hash_table = malloc(sizeof(struct hash_table));
-    hash_table_init(hash_table);
-    return hash_table;
+    size_t groups = table->capacity / LIBJSON_HASH_TABLE_GROUP_SIZE;
+    size_t group = (hash >> 7) & (groups - 1);
+    for (size_t step = 1;; step++)
+    {
+        unsigned mask = hash_table_group_free(table->ctrl + group * LIBJSON_HASH_TABLE_GROUP_SIZE);
+        if (mask)
+            return group * LIBJSON_HASH_TABLE_GROUP_SIZE + hash_table_lowest_bit(mask);
+        group = (group + step) & (groups - 1);
+    }
 }
 
-void hash_table_set(struct hash_table *table, const char *key, void *value)
+// Adds the entry at a position to the index
+static void hash_table_index_place(struct hash_table *table, size_t position)
 {
-    int hash = hash_table_hash(key);
-    struct linked_list *ll_bucket = table->bucket[hash], *ll_prev, *ll_entry;
-    struct hash_table_entry *entry;
-    struct closure *key_closure;
+    uint64_t hash = table->entries[position].hash;
+    size_t slot = hash_table_free_slot(table, hash);
+    if (table->ctrl[slot] == LIBJSON_HASH_TABLE_DELETED)
+        table->tombstones--;
+    table->ctrl[slot] = hash & 0x7F;
+    table->index[slot] = (int32_t)position;
+}
 
-    if (!ll_bucket)
+// Compacts the entries and rebuilds the index with the given number of slots,
+// or drops it when capacity is 0
+static int hash_table_rebuild(struct hash_table *table, size_t capacity)
+{
+    int32_t *index = NULL;
+    if (capacity)
     {
-        entry = malloc(sizeof(struct hash_table_entry));
-        strcpy(entry->key, key);
-        entry->value = value;
-        table->bucket[hash] = linked_list_new(entry);
+        index = hash_table_alloc(table, capacity * (sizeof(int32_t) + 1));
+        if (!index)
+            return 0;
     }
-    else
+    hash_table_mem_free(table, table->index);
+    table->index = index;
+    table->ctrl = index ? (unsigned char *)(index + capacity) : NULL;
+    table->capacity = capacity;
+    table->tombstones = 0;
+    if (table->ctrl)
+        memset(table->ctrl, LIBJSON_HASH_TABLE_EMPTY, capacity);
+
+    size_t count = 0;
+    for (size_t i = 0; i < table->count; i++)
     {
-        key_closure = hash_table_key_equals(key);
-        ll_entry = linked_list_find(ll_bucket, key_closure, &ll_prev);
-        closure_free(key_closure);
-
-        if (ll_entry)
+        if (!table->entries[i].key)
+            continue;
+        table->entries[count] = table->entries[i];
+        if (index)
         {
-            entry = linked_list_value(ll_entry);
-            entry->value = value;
+            if (!table->entries[count].hash)
+                table->entries[count].hash = hash_table_hash(table->entries[count].key, table->entries[count].length);
+            hash_table_index_place(table, count);
         }
-        else
+        count++;
+    }
+    table->count = count;
+    if (!count)
+    {
+        hash_table_mem_free(table, table->entries);
+        table->entries = NULL;
+        table->entries_capacity = 0;
+    }
+    else if (count * 4 < table->entries_capacity && !table->arena)
+    {
+        // Give back the memory of the removed entries
+        struct hash_table_entry *entries = hash_table_realloc(table, table->entries, count * sizeof(struct hash_table_entry), count * 2 * sizeof(struct hash_table_entry));
+        if (entries)
         {
-            entry = malloc(sizeof(struct hash_table_entry));
-            strcpy(entry->key, key);
-            entry->value = value;
-            linked_list_insert(ll_prev, entry);
+            table->entries = entries;
+            table->entries_capacity = count * 2;
         }
     }
+    return 1;
 }
 
-void *hash_table_get(const struct hash_table *table, const char *key)
+// Smallest capacity holding size keys under the maximum load factor of 7/8
+static size_t hash_table_capacity_for(size_t size)
 {
-    int hash = hash_table_hash(key);
-    struct linked_list *ll_bucket = table->bucket[hash], *ll_entry;
-    struct hash_table_entry *entry;
-    struct closure *key_closure;
-
-    if (!ll_bucket)
-        return NULL;
-
-    key_closure = hash_table_key_equals(key);
-    ll_entry = linked_list_find(ll_bucket, key_closure, NULL);
-    closure_free(key_closure);
-
-    if (!ll_entry)
-        return NULL;
-
-    entry = linked_list_value(ll_entry);
-    return entry->value;
+    size_t capacity = LIBJSON_HASH_TABLE_MIN_CAPACITY;
+    while (size * 8 > capacity * 7)
+        capacity *= 2;
+    return capacity;
 }
 
-void *hash_table_remove(struct hash_table *table, const char *key)
+// Copies a key, keeping a NUL terminator for callers that use it as a string
+static char *hash_table_key_copy(const struct hash_table *table, const char *key, size_t length)
 {
-    if (!table || !key)
+    char *copy = hash_table_alloc(table, length + 1);
+    if (!copy)
         return NULL;
+    memcpy(copy, key, length);
+    copy[length] = '\0';
+    return copy;
+}
 
-    int hash = hash_table_hash(key);
-    struct linked_list *ll_bucket = table->bucket[hash];
-    struct closure *key_closure;
+struct hash_table *hash_table_new(struct json_arena *arena)
+{
+    struct hash_table *hash_table = arena ? json_arena_alloc(arena, sizeof(struct hash_table)) : slab_alloc(sizeof(struct hash_table));
+    if (hash_table)
+    {
+        memset(hash_table, 0, sizeof(struct hash_table));
+        hash_table->refs = 1;
+        hash_table->arena = arena;
+    }
+    return hash_table;
+}
 
-    if (!ll_bucket)
-        return NULL;
+struct json_arena *hash_table_arena(const struct hash_table *table)
+{
+    return table ? table->arena : NULL;
+}
 
-    key_closure = hash_table_key_equals(key);
-    struct linked_list *prev = NULL;
+int hash_table_set(struct hash_table *table, const char *key, json_cell value)
+{
+    return hash_table_set_n(table, key, strlen(key), value);
+}
 
-    // Store the next pointer in case we need to update the bucket head
-    struct linked_list *next_after_head = linked_list_next(ll_bucket);
+int hash_table_set_n(struct hash_table *table, const char *key, size_t length, json_cell value)
+{
+    return hash_table_set_hashed(table, key, length, 0, value);
+}
 
-    // Remove the entry from the linked list and get the entry
-    struct hash_table_entry *removed_entry = (struct hash_table_entry *)linked_list_remove(ll_bucket, key_closure, &prev);
-    closure_free(key_closure);
+// A hash of 0 is only computed once needed, by indexed tables. Returns 0 if
+// the key could not be added.
+int hash_table_set_hashed(struct hash_table *table, const char *key, size_t length, uint64_t hash, json_cell value)
+{
+    if (!json_cell_shareable(value))
+        table->deep = 1;
 
-    if (!removed_entry)
-        return NULL;
+    // Hashed once, for both the lookup and the insertion
+    long found;
+    if (table->index)
+    {
+        if (!hash)
+            hash = hash_table_hash(key, length);
+        long slot = hash_table_find(table, key, length, hash);
+        found = slot >= 0 ? table->index[slot] : -1;
+    }
+    else
+    {
+        found = hash_table_find_small(table, key, length);
+    }
+    if (found >= 0)
+    {
+        // Replaced values keep their place in the order
+        table->entries[found].value = value;
+        return 1;
+    }
+    if (table->size >= INT32_MAX)
+        return 0;
 
-    // Update the bucket head if we removed the first element
-    if (prev == NULL)
+    // Index the table once it outgrows the small layout, or grow the index
+    int indexed = table->index || table->size >= LIBJSON_HASH_TABLE_SMALL_MAX;
+    if (indexed && (table->size + table->tombstones + 1) * 8 > table->capacity * 7)
+    {
+        if (!hash_table_rebuild(table, hash_table_capacity_for(table->size + 1)))
+            return 0;
+    }
+    if (table->count == table->entries_capacity)
     {
-        // First element was removed, update bucket head to the next element
-        table->bucket[hash] = next_after_head;
+        size_t capacity = table->entries_capacity ? table->entries_capacity * 2 : 2;
+        struct hash_table_entry *entries = hash_table_realloc(table, table->entries, table->entries_capacity * sizeof(struct hash_table_entry), capacity * sizeof(struct hash_table_entry));
+        if (!entries)
+            return 0;
+        table->entries = entries;
+        table->entries_capacity = capacity;
     }
 
-    // Get the value before freeing the entry
-    void *value = removed_entry->value;
-    free(removed_entry);
+    struct hash_table_entry *entry = &table->entries[table->count];
+    entry->key = hash_table_key_copy(table, key, length);
+    if (!entry->key)
+        return 0;
+    entry->length = length;
+    entry->value = value;
+    // A known hash is kept for when a small table gets indexed, and the one
+    // indexed by this insertion was not hashed yet
+    if (table->index && !hash)
+        hash = hash_table_hash(key, length);
+    entry->hash = hash;
+    if (table->index)
+        hash_table_index_place(table, table->count);
+    table->count++;
+    table->size++;
+    return 1;
+}
 
-    return value;
+json_cell *hash_table_get(const struct hash_table *table, const char *key)
+{
+    return hash_table_get_n(table, key, strlen(key));
 }
 
-void hash_table_free(struct hash_table *table, free_func free_value)
+json_cell *hash_table_get_n(const struct hash_table *table, const char *key, size_t length)
 {
-    if (!table)
+    long found = hash_table_lookup(table, key, length);
+    return found >= 0 ? &table->entries[found].value : NULL;
+}
+
+json_cell *hash_table_get_hashed(const struct hash_table *table, const char *key, size_t length, uint64_t hash)
+{
+    long found;
+    if (table->index)
     {
-        return;
+        long slot = hash_table_find(table, key, length, hash);
+        found = slot >= 0 ? table->index[slot] : -1;
     }
-    for (int i = 0; i < LIBJSON_HASH_TABLE_BUCKET_SIZE; i++)
+    else
     {
-        struct linked_list *current = table->bucket[i];
-        while (current)
-        {
-            struct hash_table_entry *entry = linked_list_value(current);
-            if (free_value)
-            {
-                free_value(entry->value);
-            }
-            free(entry);
-            current = linked_list_next(current);
-        }
-        linked_list_free(table->bucket[i], NULL);
+        found = hash_table_find_small(table, key, length);
     }
-    free(table);
+    return found >= 0 ? &table->entries[found].value : NULL;
 }
 
-int hash_table_keys(const struct hash_table *table, char **keys)
+int hash_table_remove(struct hash_table *table, const char *key, json_cell *value)
 {
-    int count = 0;
-    for (int i = 0; i < LIBJSON_HASH_TABLE_BUCKET_SIZE; i++)
-    {
-        struct linked_list *current = table->bucket[i];
-        while (current)
-        {
-            struct hash_table_entry *entry = linked_list_value(current);
-            if (keys)
-            {
-                keys[count] = strdup(entry->key);
-            }
-            count++;
-            current = linked_list_next(current);
-        }
-    }
-    return count;
+    if (!table || !key)
+        return 0;
+    return hash_table_remove_n(table, key, strlen(key), value);
 }
 
-int hash_table_has(const struct hash_table *table, const char *key)
+int hash_table_remove_n(struct hash_table *table, const char *key, size_t length, json_cell *value)
 {
     if (!table || !key)
-    {
         return 0;
-    }
-    int hash = hash_table_hash(key);
-    struct linked_list *ll_bucket = table->bucket[hash], *ll_entry;
-    struct closure *key_closure;
 
-    if (!ll_bucket)
+    if (!table->index)
     {
-        return 0;
+        long found = hash_table_find_small(table, key, length);
+        if (found < 0)
+            return 0;
+        *value = table->entries[found].value;
+        hash_table_key_free(table, table->entries[found].key);
+        // Keep small tables packed in insertion order
+        memmove(&table->entries[found], &table->entries[found + 1], (table->count - found - 1) * sizeof(struct hash_table_entry));
+        table->count--;
+        table->size--;
+        if (table->size == 0)
+            hash_table_rebuild(table, 0);
+        return 1;
     }
 
-    key_closure = hash_table_key_equals(key);
-    ll_entry = linked_list_find(ll_bucket, key_closure, NULL);
-    closure_free(key_closure);
-
-    return ll_entry != NULL;
+    long slot = hash_table_find(table, key, length, hash_table_hash(key, length));
+    if (slot < 0)
+        return 0;
+    struct hash_table_entry *entry = &table->entries[table->index[slot]];
+    *value = entry->value;
+    hash_table_key_free(table, entry->key);
+    entry->key = NULL;
+    // Later keys of the probe sequence may have gone past this slot
+    table->ctrl[slot] = LIBJSON_HASH_TABLE_DELETED;
+    table->tombstones++;
+    table->size--;
+
+    // Shrink once the table is mostly empty, down to the small layout, and
+    // compact the entries once they are mostly holes
+    if (table->size <= LIBJSON_HASH_TABLE_SMALL_MAX / 2)
+        hash_table_rebuild(table, 0);
+    else if (table->capacity > LIBJSON_HASH_TABLE_MIN_CAPACITY && table->size * 4 < table->capacity)
+        hash_table_rebuild(table, hash_table_capacity_for(table->size));
+    else if (table->size * 2 < table->count)
+        hash_table_rebuild(table, table->capacity);
+
+    return 1;
 }
 
-void hash_table_foreach(const struct hash_table *table, struct closure *closure)
+void hash_table_free(struct hash_table *table, void (*free_value)(json_cell))
 {
-    if (!table || !closure)
+    if (!table || table->arena)
     {
         return;
     }
-    for (int i = 0; i < LIBJSON_HASH_TABLE_BUCKET_SIZE; i++)
+    for (size_t i = 0; i < table->count; i++)
     {
-        struct linked_list *current = table->bucket[i];
-        while (current)
+        struct hash_table_entry *entry = &table->entries[i];
+        if (!entry->key)
+            continue;
+        if (free_value)
         {
-            struct hash_table_entry *entry = linked_list_value(current);
-            closure_invoke(closure, entry->value);
-            current = linked_list_next(current);
+            free_value(entry->value);
         }
+        hash_table_key_free(table, entry->key);
     }
+    json_mem_free(table->entries);
+    json_mem_free(table->index);
+    json_mem_free(table->keys);
+    slab_free(table, sizeof(struct hash_table));
 }
 
-const char *hash_table_entry_key(const struct hash_table_entry *entry)
+// Tables of copied objects are shared until one of them is modified, which
+// then gets a clone of its own. Tables of an arena are never shared.
+struct hash_table *hash_table_share(struct hash_table *table)
 {
-    return entry ? entry->key : NULL;
+    if (table)
+        json_refs_retain(&table->refs);
+    return table;
 }
 
-void *hash_table_entry_value(const struct hash_table_entry *entry)
+// Drops a reference, and returns 1 if it was the last one, in which case the
+// caller frees the table
+int hash_table_release(struct hash_table *table)
 {
-    return entry ? entry->value : NULL;
+    return table && json_refs_release(&table->refs);
 }
 
-struct hash_table_iter
+int hash_table_shared(const struct hash_table *table)
 {
-    const struct hash_table *table;
-    int bucket_index;
-    struct linked_list *current_entry;
-};
+    return table && json_refs_shared(&table->refs);
+}
 
-struct hash_table_iter *hash_table_iter_new(const struct hash_table *table)
+// Tables that have held objects, arrays or other values that copies cannot
+// share, see json_cell_shareable(), are cloned by copies instead of shared
+int hash_table_deep(const struct hash_table *table)
 {
-    struct hash_table_iter *iter = malloc(sizeof(struct hash_table_iter));
-    if (!iter)
+    return table && table->deep;
+}
+
+// Returns a table of the heap with the same keys, in the same order, and
+// copies of the values. The entries and the index are copied as they are, and
+// the keys are copied into a single block.
+struct hash_table *hash_table_clone(const struct hash_table *table, int (*copy_value)(json_cell, json_cell *), void (*free_value)(json_cell))
+{
+    struct hash_table *clone = hash_table_new(NULL);
+    if (!clone || !table || !table->size)
+        return clone;
+
+    size_t keys_size = 0;
+    for (size_t i = 0; i < table->count; i++)
     {
+        if (table->entries[i].key)
+            keys_size += table->entries[i].length + 1;
+    }
+    clone->entries = json_mem_alloc(table->count * sizeof(struct hash_table_entry));
+    clone->keys = json_mem_alloc(keys_size);
+    if (table->index)
+        clone->index = json_mem_alloc(table->capacity * (sizeof(int32_t) + 1));
+    if (!clone->entries || !clone->keys || (table->index && !clone->index))
+    {
+        hash_table_free(clone, NULL);
         return NULL;
     }
-    iter->table = table;
-    iter->bucket_index = 0;
-    iter->current_entry = NULL;
-
-    // Find the first non-empty bucket
-    while (iter->bucket_index < LIBJSON_HASH_TABLE_BUCKET_SIZE && !table->bucket[iter->bucket_index])
+    clone->count = table->count;
+    clone->entries_capacity = table->count;
+    clone->size = table->size;
+    clone->keys_size = keys_size;
+    if (table->index)
     {
-        iter->bucket_index++;
+        memcpy(clone->index, table->index, table->capacity * (sizeof(int32_t) + 1));
+        clone->ctrl = (unsigned char *)(clone->index + table->capacity);
+        clone->capacity = table->capacity;
+        clone->tombstones = table->tombstones;
     }
+    clone->deep = table->deep;
 
-    if (iter->bucket_index < LIBJSON_HASH_TABLE_BUCKET_SIZE)
+    // Values are copied one by one, as getters may be boxing them
+    char *key = clone->keys;
+    for (size_t i = 0; i < clone->count; i++)
     {
-        iter->current_entry = table->bucket[iter->bucket_index];
+        struct hash_table_entry *entry = &clone->entries[i];
+        entry->hash = table->entries[i].hash;
+        entry->length = table->entries[i].length;
+        entry->key = NULL;
+        if (!table->entries[i].key)
+            continue;
+        memcpy(key, table->entries[i].key, entry->length + 1);
+        entry->key = key;
+        key += entry->length + 1;
+        if (!copy_value(json_cell_load(&table->entries[i].value), &entry->value))
+        {
+            // Values are only freed up to the failed one
+            clone->count = i;
+            hash_table_free(clone, free_value);
+            return NULL;
+        }
     }
-
-    return iter;
+    return clone;
 }
 
-void hash_table_iter_free(struct hash_table_iter *iter)
+int hash_table_keys(const struct hash_table *table, char **keys)
 {
-    if (iter)
+    if (!keys)
+        return (int)table->size;
+
+    int count = 0;
+    for (size_t i = 0; i < table->count; i++)
     {
-        free(iter);
+        if (table->entries[i].key)
+            keys[count++] = json_mem_strdup(table->entries[i].key);
     }
+    return count;
 }
 
-struct hash_table_entry *hash_table_iter_next(struct hash_table_iter *iter)
+int hash_table_has(const struct hash_table *table, const char *key)
 {
-    if (!iter || !iter->current_entry)
+    if (!table || !key)
     {
-        return NULL;
+        return 0;
     }
+    return hash_table_lookup(table, key, strlen(key)) >= 0;
+}
 
-    struct hash_table_entry *entry = linked_list_value(iter->current_entry);
-    iter->current_entry = linked_list_next(iter->current_entry);
+const char *hash_table_entry_key(const struct hash_table_entry *entry)
+{
+    return entry ? entry->key : NULL;
+}
 
-    // Move to the next non-empty bucket if needed
-    while (!iter->current_entry && ++iter->bucket_index < LIBJSON_HASH_TABLE_BUCKET_SIZE)
-    {
-        iter->current_entry = iter->table->bucket[iter->bucket_index];
-    }
+size_t hash_table_entry_key_length(const struct hash_table_entry *entry)
+{
+    return entry ? entry->length : 0;
+}
 
-    return entry;
+json_cell *hash_table_entry_value(const struct hash_table_entry *entry)
+{
+    return entry ? (json_cell *)&entry->value : NULL;
 }
 
-int hash_table_iter_has_next(struct hash_table_iter *iter)
+// Skips the holes left by removed keys, so that the table is iterated in
+// insertion order from a position kept by the caller
+struct hash_table_entry *hash_table_next(const struct hash_table *table, size_t *position)
 {
-    if (!iter)
+    if (!table || !position)
     {
-        return 0;
+        return NULL;
+    }
+    while (*position < table->count)
+    {
+        struct hash_table_entry *entry = &table->entries[(*position)++];
+        if (entry->key)
+        {
+            return entry;
+        }
     }
-    return iter->current_entry != NULL;
+    return NULL;
 }
@@ -90,7 +90,7 @@ struct json_token json5_read_token(FILE *in, struct error_context *errctx)
                         if (end_c == '/') {
                             break; // End of comment
                         } else {
-                            ungetc(end_c, in);
+                            json_ungetc(end_c, in, errctx);
                             i--;
                         }
                     }
@@ -98,7 +98,7 @@ struct json_token json5_read_token(FILE *in, struct error_context *errctx)
                 continue; // Skip whitespace again after comment
             } else {
                 // Not a comment, put back the next character
-                ungetc(next_c, in);
+                json_ungetc(next_c, in, errctx);
                 break;
             }
         } else {
@@ -111,11 +111,12 @@ struct json_token json5_read_token(FILE *in, struct error_context *errctx)
         token.type = JSON_TOKEN_EOF;
         return token;
     }
+    token.start = errctx->offset - 1;
 
     // Check for JSON5 unquoted identifiers first (before keywords)
     if (isalpha(c) || c == '_' || c == '$')
     {
-        ungetc(c, in);
+        json_ungetc(c, in, errctx);
         char buffer[256];
         int j = 0;
         i = 0; // Because of ungetc, we need to reset i
@@ -133,7 +134,7 @@ struct json_token json5_read_token(FILE *in, struct error_context *errctx)
         }
         if (c != EOF)
         {
-            ungetc(c, in);
+            json_ungetc(c, in, errctx);
             i--; // Adjust index for ungetc
         }
         buffer[j] = '\0';
@@ -154,7 +155,7 @@ struct json_token json5_read_token(FILE *in, struct error_context *errctx)
         else if (j > 0)
         {
             // It's an unquoted identifier
-            token.value = strdup(buffer);
+            token.value = json_mem_strdup(buffer);
             token.type = JSON_TOKEN_STRING; // Treat unquoted identifiers as strings
         }
         else
@@ -206,8 +207,8 @@ struct json_token json5_read_token(FILE *in, struct error_context *errctx)
     case '\'': // JSON5 supports single quotes
     {
         char quote_char = c;
-        char *str = NULL;
-        struct linked_list *char_list = NULL, *char_list_ptr = NULL;
+        struct string_buffer text;
+        string_buffer_init(&text);
         i = 1;
         while ((c = update_error_context(errctx, fgetc(in), i++)) != quote_char)
         {
@@ -215,8 +216,7 @@ struct json_token json5_read_token(FILE *in, struct error_context *errctx)
             {
                 token.type = JSON_TOKEN_INVALID;
                 strcpy(errctx->message, "Unterminated string");
-                if (char_list)
-                    linked_list_free(char_list, NULL);
+                string_buffer_free(&text);
                 return token;
             }
             if (c == '\\')
@@ -262,8 +262,7 @@ struct json_token json5_read_token(FILE *in, struct error_context *errctx)
                         else
                         {
                             token.type = JSON_TOKEN_INVALID;
-                            if (char_list)
-                                linked_list_free(char_list, NULL);
+                            string_buffer_free(&text);
                             return token;
                         }
                     }
@@ -272,54 +271,19 @@ struct json_token json5_read_token(FILE *in, struct error_context *errctx)
                 }
                 default: // Error: Invalid escape sequence
                     token.type = JSON_TOKEN_INVALID;
-                    if (char_list)
-                        linked_list_free(char_list, NULL);
+                    string_buffer_free(&text);
                     return token;
                 }
             }
-            if (char_list)
-            {
-                char_list_ptr = linked_list_insert(char_list_ptr, (void *)(long)c);
-            }
-            else
-            {
-                char_list = linked_list_new((void *)(long)c);
-                char_list_ptr = char_list;
-            }
-        }
-        if (char_list)
-        {
-            int length = linked_list_length(char_list);
-            str = (char *)malloc(length + 1);
-            if (str)
-            {
-                struct linked_list *node = char_list;
-                for (int j = 0; j < length; j++)
-                {
-                    str[j] = (char)(long)linked_list_value(node);
-                    node = linked_list_next(node);
-                }
-                str[length] = '\0';
-                token.value = str;
-                token.type = JSON_TOKEN_STRING;
-            }
-            linked_list_free(char_list, NULL);
-        }
-        else
-        {
-            // Empty string
-            str = (char *)malloc(1);
-            if (str)
-            {
-                str[0] = '\0';
-                token.value = str;
-                token.type = JSON_TOKEN_STRING;
-            }
-            else
+            if (!string_buffer_push(&text, (char)c))
             {
                 token.type = JSON_TOKEN_INVALID;
+                string_buffer_free(&text);
+                return token;
             }
         }
+        token.value = string_buffer_take(&text);
+        token.type = token.value ? JSON_TOKEN_STRING : JSON_TOKEN_INVALID;
         break;
     }
     default: // Number or INVALID
@@ -327,7 +291,7 @@ struct json_token json5_read_token(FILE *in, struct error_context *errctx)
         // Check if this could be a valid number (must start with digit or minus)
         if (isdigit(c) || c == '-')
         {
-            ungetc(c, in);
+            json_ungetc(c, in, errctx);
             char buffer[32];
             int j = 0;
             i = 0; // Because of ungetc, we need to reset i
@@ -346,13 +310,13 @@ struct json_token json5_read_token(FILE *in, struct error_context *errctx)
             }
             if (c != EOF)
             {
-                ungetc(c, in);
+                json_ungetc(c, in, errctx);
                 i--; // Adjust index for ungetc
             }
             buffer[j] = '\0';
             if (j > 0)
             {
-                token.value = strdup(buffer);
+                token.value = json_mem_strdup(buffer);
                 token.type = JSON_TOKEN_NUMBER;
             }
             else
@@ -378,9 +342,12 @@ struct json_token json5_read_token(FILE *in, struct error_context *errctx)
 // JSON5 parser - reuses JSON parser logic but with JSON5 tokenizer
 int json5_parser_json(FILE *in, struct json_token *token, struct json **dest, struct error_context *errctx)
 {
-    return json5_parser_literal(in, token, dest, errctx) || 
-           json5_parser_array(in, token, dest, errctx) || 
-           json5_parser_object(in, token, dest, errctx);
+    struct json_span *span = json_span_open(errctx, token);
+    int parsed = json5_parser_literal(in, token, dest, errctx) ||
+                 json5_parser_array(in, token, dest, errctx) ||
+                 json5_parser_object(in, token, dest, errctx);
+    json_span_close(errctx, span, parsed ? *dest : NULL);
+    return parsed;
 }
 
 int json5_parser_literal(FILE *in, struct json_token *token, struct json **dest, struct error_context *errctx)
@@ -503,7 +470,9 @@ int json5_parser_key_value(FILE *in, struct json_token *token, struct json *obje
 {
     if (token->type == JSON_TOKEN_STRING)
     {
-        char *key = strdup(token->value);
+        // The key takes over the text of the token
+        char *key = token->value;
+        token->value = NULL;
         *token = json5_read_token(in, errctx);
         if (token->type == JSON_TOKEN_COLON)
         {
@@ -512,20 +481,20 @@ int json5_parser_key_value(FILE *in, struct json_token *token, struct json *obje
             if (json5_parser_json(in, token, &value, errctx))
             {
                 json_object_set(object, key, value);
-                free(key);
+                json_mem_free(key);
                 return 1;
             }
             else
             {
                 strcpy(errctx->message, "Expected JSON5 value after ':' in object.");
-                free(key);
+                json_mem_free(key);
                 return 0;
             }
         }
         else
         {
             strcpy(errctx->message, "Expecting ':' after key.");
-            free(key);
+            json_mem_free(key);
             return 0;
         }
     }
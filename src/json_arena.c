@@ -0,0 +1,242 @@
+#include "json_internal.h"
+#include "libjson/json_arena.h"
+
+#include <sys/mman.h>
+
+/**
+ * @section Arena allocation functions
+ */
+
+#define LIBJSON_ARENA_DEFAULT_CHUNK_SIZE (1024 * 1024)
+// Smaller chunks are rounded up, so that a chunk always has room past its
+// header
+#define LIBJSON_ARENA_MIN_CHUNK_SIZE 1024
+#define LIBJSON_ARENA_ALIGNMENT 8
+#define LIBJSON_ARENA_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+struct json_arena_chunk
+{
+    struct json_arena_chunk *next;
+    size_t size; // including this header
+    int mapped;
+    int oversized; // holds a single allocation larger than a chunk
+};
+
+struct json_arena
+{
+    struct json_arena_chunk *chunks; // the current chunk first
+    char *bump;                      // unused part of the current chunk
+    char *end;
+    char *last; // last allocation, which can grow in place
+    size_t chunk_size;
+    int flags;
+    json_malloc_func malloc_fn; // allocator of the chunks, NULL for the one of the library
+    json_free_func free_fn;
+    void *ctx;
+};
+
+#define LIBJSON_ARENA_HEADER_SIZE \
+    ((sizeof(struct json_arena_chunk) + LIBJSON_ARENA_ALIGNMENT - 1) & ~(size_t)(LIBJSON_ARENA_ALIGNMENT - 1))
+
+static struct json_arena_chunk *json_arena_chunk_new(const struct json_arena *arena, size_t size)
+{
+    struct json_arena_chunk *chunk = NULL;
+    int mapped = 0;
+#ifdef MADV_HUGEPAGE
+    if (arena->flags & JSON_ARENA_HUGE_PAGES)
+    {
+        size = (size + LIBJSON_ARENA_HUGE_PAGE_SIZE - 1) & ~(size_t)(LIBJSON_ARENA_HUGE_PAGE_SIZE - 1);
+        void *memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory != MAP_FAILED)
+        {
+            // Only a hint: the chunk is used with regular pages otherwise
+            madvise(memory, size, MADV_HUGEPAGE);
+            chunk = memory;
+            mapped = 1;
+        }
+    }
+#endif
+    if (!chunk)
+        chunk = arena->malloc_fn ? arena->malloc_fn(size, arena->ctx) : json_mem_alloc(size);
+    if (!chunk)
+        return NULL;
+    chunk->size = size;
+    chunk->mapped = mapped;
+    chunk->oversized = 0;
+    chunk->next = NULL;
+    return chunk;
+}
+
+static void json_arena_chunk_free(const struct json_arena *arena, struct json_arena_chunk *chunk)
+{
+    if (chunk->mapped)
+        munmap(chunk, chunk->size);
+    else if (arena->free_fn)
+        arena->free_fn(chunk, arena->ctx);
+    else
+        json_mem_free(chunk);
+}
+
+struct json_arena *json_arena_new(size_t chunk_size, int flags)
+{
+    return json_arena_new_allocator(chunk_size, flags, NULL, NULL, NULL);
+}
+
+struct json_arena *json_arena_new_allocator(size_t chunk_size, int flags, json_malloc_func malloc_fn, json_free_func free_fn, void *ctx)
+{
+    if (!malloc_fn || !free_fn)
+    {
+        malloc_fn = NULL;
+        free_fn = NULL;
+    }
+    struct json_arena *arena = malloc_fn ? malloc_fn(sizeof(struct json_arena), ctx) : json_mem_alloc(sizeof(struct json_arena));
+    if (!arena)
+        return NULL;
+    arena->chunks = NULL;
+    arena->bump = arena->end = arena->last = NULL;
+    arena->chunk_size = chunk_size ? chunk_size : LIBJSON_ARENA_DEFAULT_CHUNK_SIZE;
+    if (arena->chunk_size < LIBJSON_ARENA_MIN_CHUNK_SIZE)
+        arena->chunk_size = LIBJSON_ARENA_MIN_CHUNK_SIZE;
+    arena->flags = flags;
+    arena->malloc_fn = malloc_fn;
+    arena->free_fn = free_fn;
+    arena->ctx = ctx;
+    return arena;
+}
+
+void json_arena_reset(struct json_arena *arena)
+{
+    if (!arena || !arena->chunks)
+        return;
+
+    // The oldest chunk of regular size is kept for the next allocations, but
+    // not a chunk of an oversized allocation, which would stay pinned
+    struct json_arena_chunk *kept = NULL;
+    struct json_arena_chunk *chunk = arena->chunks;
+    while (chunk)
+    {
+        struct json_arena_chunk *next = chunk->next;
+        if (!chunk->oversized)
+        {
+            if (kept)
+                json_arena_chunk_free(arena, kept);
+            kept = chunk;
+        }
+        else
+        {
+            json_arena_chunk_free(arena, chunk);
+        }
+        chunk = next;
+    }
+    arena->chunks = kept;
+    arena->bump = kept ? (char *)kept + LIBJSON_ARENA_HEADER_SIZE : NULL;
+    arena->end = kept ? (char *)kept + kept->size : NULL;
+    arena->last = NULL;
+    if (kept)
+        kept->next = NULL;
+}
+
+void json_arena_free(struct json_arena *arena)
+{
+    if (!arena)
+        return;
+
+    struct json_arena_chunk *chunk = arena->chunks;
+    while (chunk)
+    {
+        struct json_arena_chunk *next = chunk->next;
+        json_arena_chunk_free(arena, chunk);
+        chunk = next;
+    }
+    if (arena->free_fn)
+        arena->free_fn(arena, arena->ctx);
+    else
+        json_mem_free(arena);
+}
+
+void *json_arena_alloc(struct json_arena *arena, size_t size)
+{
+    size = (size + LIBJSON_ARENA_ALIGNMENT - 1) & ~(size_t)(LIBJSON_ARENA_ALIGNMENT - 1);
+    if ((size_t)(arena->end - arena->bump) < size || !arena->bump)
+    {
+        size_t chunk_size = arena->chunk_size;
+        if (size > chunk_size - LIBJSON_ARENA_HEADER_SIZE)
+            chunk_size = size + LIBJSON_ARENA_HEADER_SIZE;
+        struct json_arena_chunk *chunk = json_arena_chunk_new(arena, chunk_size);
+        if (!chunk)
+            return NULL;
+        chunk->oversized = chunk_size > arena->chunk_size;
+        if (chunk->oversized && arena->chunks)
+        {
+            // Oversized allocations get a chunk of their own, and the current
+            // chunk stays in use
+            chunk->next = arena->chunks->next;
+            arena->chunks->next = chunk;
+            arena->last = NULL;
+            return (char *)chunk + LIBJSON_ARENA_HEADER_SIZE;
+        }
+        chunk->next = arena->chunks;
+        arena->chunks = chunk;
+        arena->bump = (char *)chunk + LIBJSON_ARENA_HEADER_SIZE;
+        arena->end = (char *)chunk + chunk->size;
+    }
+    arena->last = arena->bump;
+    arena->bump += size;
+    return arena->last;
+}
+
+// Grows the last allocation in place when possible, or moves it
+void *json_arena_realloc(struct json_arena *arena, void *ptr, size_t old_size, size_t size)
+{
+    if (ptr && ptr == arena->last)
+    {
+        size_t aligned = (size + LIBJSON_ARENA_ALIGNMENT - 1) & ~(size_t)(LIBJSON_ARENA_ALIGNMENT - 1);
+        if ((size_t)(arena->end - arena->last) >= aligned)
+        {
+            arena->bump = arena->last + aligned;
+            return ptr;
+        }
+    }
+    void *copy = json_arena_alloc(arena, size);
+    if (copy && ptr)
+        memcpy(copy, ptr, old_size < size ? old_size : size);
+    return copy;
+}
+
+char *json_arena_strndup(struct json_arena *arena, const char *text, size_t length)
+{
+    char *copy = json_arena_alloc(arena, length + 1);
+    if (!copy)
+        return NULL;
+    memcpy(copy, text, length);
+    copy[length] = '\0';
+    return copy;
+}
+
+struct json *json_arena_number(struct json_arena *arena, double value)
+{
+    if (!arena)
+        return NULL;
+    return json_number_new(arena, value);
+}
+
+struct json *json_arena_string(struct json_arena *arena, const char *value)
+{
+    if (!arena || !value)
+        return NULL;
+    return json_string_new(arena, value);
+}
+
+struct json *json_arena_array(struct json_arena *arena)
+{
+    if (!arena)
+        return NULL;
+    return json_array_new(arena);
+}
+
+struct json *json_arena_object(struct json_arena *arena)
+{
+    if (!arena)
+        return NULL;
+    return json_object_new(arena);
+}
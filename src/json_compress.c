@@ -0,0 +1,566 @@
+#define _GNU_SOURCE // fopencookie
+
+#include "libjson/json_compress.h"
+#include "json_memory.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/types.h>
+
+#ifdef LIBJSON_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef LIBJSON_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+/**
+ * @section Compressed stream functions
+ */
+
+// Size of the compressed and uncompressed blocks moved at once
+#define LIBJSON_COMPRESSED_BLOCK_SIZE (1 << 17)
+// Number of uncompressed blocks the helper thread may fill ahead of the parser
+#define LIBJSON_COMPRESSED_BLOCKS 4
+
+struct json_compressed_block
+{
+    char data[LIBJSON_COMPRESSED_BLOCK_SIZE];
+    size_t length;
+};
+
+struct json_compressed_stream
+{
+    FILE *raw;
+    enum json_compression compression;
+    int writing;
+#ifdef LIBJSON_HAVE_ZLIB
+    z_stream gzip;
+    int gzip_member_done;
+#endif
+#ifdef LIBJSON_HAVE_ZSTD
+    ZSTD_DStream *zstd_in;
+    ZSTD_CStream *zstd_out;
+    // Last hint of the decoder, 0 once a frame is complete and all of its
+    // data flushed
+    size_t zstd_hint;
+#endif
+    // Compressed bytes read from the raw stream, or produced for it
+    char buffer[LIBJSON_COMPRESSED_BLOCK_SIZE];
+    size_t buffer_length;
+    size_t buffer_pos;
+    int raw_eof;
+
+    // Decompression pipeline: blocks are filled by the helper thread in
+    // order and consumed in the same order by the reading side
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    struct json_compressed_block *blocks;
+    unsigned long produced;
+    unsigned long consumed;
+    size_t block_pos;
+    int finished;
+    int failed;
+    int closing;
+};
+
+int json_compression_supported(enum json_compression compression)
+{
+    switch (compression)
+    {
+    case JSON_COMPRESSION_AUTO:
+    case JSON_COMPRESSION_NONE:
+        return 1;
+    case JSON_COMPRESSION_GZIP:
+#ifdef LIBJSON_HAVE_ZLIB
+        return 1;
+#else
+        return 0;
+#endif
+    case JSON_COMPRESSION_ZSTD:
+#ifdef LIBJSON_HAVE_ZSTD
+        return 1;
+#else
+        return 0;
+#endif
+    }
+    return 0;
+}
+
+// Refills the buffer of compressed input. Returns 0 at the end of the raw stream.
+static int json_compressed_fill(struct json_compressed_stream *stream)
+{
+    if (stream->buffer_pos < stream->buffer_length)
+        return 1;
+    if (stream->raw_eof)
+        return 0;
+    stream->buffer_length = fread(stream->buffer, 1, sizeof(stream->buffer), stream->raw);
+    stream->buffer_pos = 0;
+    if (stream->buffer_length == 0)
+        stream->raw_eof = 1;
+    return stream->buffer_length > 0;
+}
+
+// Detects the compression format from the magic number of the data
+static enum json_compression json_compressed_detect(struct json_compressed_stream *stream)
+{
+    while (stream->buffer_length < 4 && !stream->raw_eof)
+    {
+        size_t n = fread(stream->buffer + stream->buffer_length, 1, 4 - stream->buffer_length, stream->raw);
+        if (n == 0)
+            stream->raw_eof = 1;
+        stream->buffer_length += n;
+    }
+    const unsigned char *magic = (const unsigned char *)stream->buffer;
+    if (stream->buffer_length >= 2 && magic[0] == 0x1F && magic[1] == 0x8B)
+        return JSON_COMPRESSION_GZIP;
+    if (stream->buffer_length >= 4 && magic[0] == 0x28 && magic[1] == 0xB5 && magic[2] == 0x2F && magic[3] == 0xFD)
+        return JSON_COMPRESSION_ZSTD;
+    return JSON_COMPRESSION_NONE;
+}
+
+// Decompresses up to size bytes. Returns the byte count, 0 at the end of the
+// data or -1 on error.
+static ssize_t json_decompress(struct json_compressed_stream *stream, char *out, size_t size)
+{
+    size_t length = 0;
+    switch (stream->compression)
+    {
+#ifdef LIBJSON_HAVE_ZLIB
+    case JSON_COMPRESSION_GZIP:
+        stream->gzip.next_out = (Bytef *)out;
+        stream->gzip.avail_out = size;
+        while (stream->gzip.avail_out > 0)
+        {
+            if (!json_compressed_fill(stream))
+            {
+                // The data may only end between two members
+                if (!stream->gzip_member_done)
+                    return -1;
+                break;
+            }
+            if (stream->gzip_member_done)
+            {
+                // Another member follows the one that ended
+                if (inflateReset(&stream->gzip) != Z_OK)
+                    return -1;
+                stream->gzip_member_done = 0;
+            }
+            stream->gzip.next_in = (Bytef *)stream->buffer + stream->buffer_pos;
+            stream->gzip.avail_in = stream->buffer_length - stream->buffer_pos;
+            int ret = inflate(&stream->gzip, Z_NO_FLUSH);
+            stream->buffer_pos = stream->buffer_length - stream->gzip.avail_in;
+            if (ret == Z_STREAM_END)
+                stream->gzip_member_done = 1;
+            else if (ret != Z_OK)
+                return -1;
+        }
+        return size - stream->gzip.avail_out;
+#endif
+#ifdef LIBJSON_HAVE_ZSTD
+    case JSON_COMPRESSION_ZSTD:
+    {
+        ZSTD_outBuffer output = {out, size, 0};
+        while (output.pos < output.size)
+        {
+            // Without more input, the decoder still flushes the data it holds
+            ZSTD_inBuffer input = {stream->buffer, 0, 0};
+            if (json_compressed_fill(stream))
+            {
+                input.size = stream->buffer_length;
+                input.pos = stream->buffer_pos;
+            }
+            else if (stream->zstd_hint == 0)
+                break; // The data ended between two frames
+            size_t before = output.pos;
+            size_t hint = ZSTD_decompressStream(stream->zstd_in, &output, &input);
+            if (ZSTD_isError(hint))
+                return -1;
+            stream->buffer_pos = input.pos;
+            stream->zstd_hint = hint;
+            // The data ended in the middle of a frame, which is an error once
+            // the decoded data is handed out
+            if (input.size == 0 && output.pos == before)
+                return output.pos > 0 ? (ssize_t)output.pos : -1;
+        }
+        return output.pos;
+    }
+#endif
+    default:
+        while (length < size && json_compressed_fill(stream))
+        {
+            size_t available = stream->buffer_length - stream->buffer_pos;
+            size_t n = available < size - length ? available : size - length;
+            memcpy(out + length, stream->buffer + stream->buffer_pos, n);
+            stream->buffer_pos += n;
+            length += n;
+        }
+        return length;
+    }
+}
+
+// Helper thread filling the blocks ahead of the reading side
+static void *json_decompress_thread(void *arg)
+{
+    struct json_compressed_stream *stream = arg;
+    pthread_mutex_lock(&stream->lock);
+    while (!stream->closing && !stream->finished && !stream->failed)
+    {
+        if (stream->produced - stream->consumed == LIBJSON_COMPRESSED_BLOCKS)
+        {
+            pthread_cond_wait(&stream->cond, &stream->lock);
+            continue;
+        }
+        struct json_compressed_block *block = &stream->blocks[stream->produced % LIBJSON_COMPRESSED_BLOCKS];
+        // Only this thread touches the codec, so it can run unlocked
+        pthread_mutex_unlock(&stream->lock);
+        ssize_t n = json_decompress(stream, block->data, sizeof(block->data));
+        pthread_mutex_lock(&stream->lock);
+        if (n < 0)
+            stream->failed = 1;
+        else if (n == 0)
+            stream->finished = 1;
+        else
+        {
+            block->length = n;
+            stream->produced++;
+        }
+        pthread_cond_broadcast(&stream->cond);
+    }
+    pthread_mutex_unlock(&stream->lock);
+    return NULL;
+}
+
+static ssize_t json_compressed_read(void *cookie, char *buf, size_t size)
+{
+    struct json_compressed_stream *stream = cookie;
+    size_t length = 0;
+    pthread_mutex_lock(&stream->lock);
+    while (length < size)
+    {
+        if (stream->produced == stream->consumed)
+        {
+            // Hand out what is there rather than waiting for a full buffer
+            if (length > 0 || stream->finished)
+                break;
+            if (stream->failed)
+            {
+                pthread_mutex_unlock(&stream->lock);
+                errno = EIO;
+                return -1;
+            }
+            pthread_cond_wait(&stream->cond, &stream->lock);
+            continue;
+        }
+        struct json_compressed_block *block = &stream->blocks[stream->consumed % LIBJSON_COMPRESSED_BLOCKS];
+        size_t available = block->length - stream->block_pos;
+        size_t n = available < size - length ? available : size - length;
+        memcpy(buf + length, block->data + stream->block_pos, n);
+        length += n;
+        stream->block_pos += n;
+        if (stream->block_pos == block->length)
+        {
+            stream->consumed++;
+            stream->block_pos = 0;
+            pthread_cond_broadcast(&stream->cond);
+        }
+    }
+    pthread_mutex_unlock(&stream->lock);
+    return length;
+}
+
+// Writes the pending compressed output to the raw stream
+static int json_compressed_flush(struct json_compressed_stream *stream)
+{
+    if (stream->buffer_length > 0 && fwrite(stream->buffer, 1, stream->buffer_length, stream->raw) != stream->buffer_length)
+        return 0;
+    stream->buffer_length = 0;
+    return 1;
+}
+
+// Compresses data, finishing the compressed stream when finish is set
+static int json_compress(struct json_compressed_stream *stream, const char *data, size_t size, int finish)
+{
+    switch (stream->compression)
+    {
+#ifdef LIBJSON_HAVE_ZLIB
+    case JSON_COMPRESSION_GZIP:
+    {
+        stream->gzip.next_in = (Bytef *)data;
+        stream->gzip.avail_in = size;
+        int ret;
+        do
+        {
+            stream->gzip.next_out = (Bytef *)stream->buffer + stream->buffer_length;
+            stream->gzip.avail_out = sizeof(stream->buffer) - stream->buffer_length;
+            ret = deflate(&stream->gzip, finish ? Z_FINISH : Z_NO_FLUSH);
+            if (ret == Z_STREAM_ERROR)
+                return 0;
+            stream->buffer_length = sizeof(stream->buffer) - stream->gzip.avail_out;
+            if ((stream->gzip.avail_out == 0 || finish) && !json_compressed_flush(stream))
+                return 0;
+        } while (stream->gzip.avail_in > 0 || (finish && ret != Z_STREAM_END));
+        return 1;
+    }
+#endif
+#ifdef LIBJSON_HAVE_ZSTD
+    case JSON_COMPRESSION_ZSTD:
+    {
+        ZSTD_inBuffer input = {data, size, 0};
+        size_t remaining;
+        do
+        {
+            ZSTD_outBuffer output = {stream->buffer, sizeof(stream->buffer), stream->buffer_length};
+            remaining = finish ? ZSTD_endStream(stream->zstd_out, &output) : ZSTD_compressStream(stream->zstd_out, &output, &input);
+            if (ZSTD_isError(remaining))
+                return 0;
+            stream->buffer_length = output.pos;
+            if ((output.pos == output.size || finish) && !json_compressed_flush(stream))
+                return 0;
+        } while (input.pos < input.size || (finish && remaining > 0));
+        return 1;
+    }
+#endif
+    default:
+        return size == 0 || fwrite(data, 1, size, stream->raw) == size;
+    }
+}
+
+static ssize_t json_compressed_write(void *cookie, const char *buf, size_t size)
+{
+    struct json_compressed_stream *stream = cookie;
+    if (!json_compress(stream, buf, size, 0))
+    {
+        errno = EIO;
+        return 0;
+    }
+    return size;
+}
+
+static void json_compressed_free(struct json_compressed_stream *stream)
+{
+#ifdef LIBJSON_HAVE_ZLIB
+    if (stream->compression == JSON_COMPRESSION_GZIP)
+    {
+        if (stream->writing)
+            deflateEnd(&stream->gzip);
+        else
+            inflateEnd(&stream->gzip);
+    }
+#endif
+#ifdef LIBJSON_HAVE_ZSTD
+    ZSTD_freeDStream(stream->zstd_in);
+    ZSTD_freeCStream(stream->zstd_out);
+#endif
+    json_mem_free(stream->blocks);
+    json_mem_free(stream);
+}
+
+static int json_compressed_close(void *cookie)
+{
+    struct json_compressed_stream *stream = cookie;
+    int result = 0;
+    if (stream->writing)
+    {
+        if (!json_compress(stream, NULL, 0, 1))
+            result = EOF;
+    }
+    else
+    {
+        pthread_mutex_lock(&stream->lock);
+        stream->closing = 1;
+        pthread_cond_broadcast(&stream->cond);
+        pthread_mutex_unlock(&stream->lock);
+        pthread_join(stream->thread, NULL);
+        pthread_cond_destroy(&stream->cond);
+        pthread_mutex_destroy(&stream->lock);
+    }
+    if (fclose(stream->raw) != 0)
+        result = EOF;
+    json_compressed_free(stream);
+    return result;
+}
+
+#ifdef LIBJSON_HAVE_ZLIB
+// zlib allocates through the allocator of the library too
+static voidpf json_zlib_alloc(voidpf opaque, uInt items, uInt size)
+{
+    (void)opaque;
+    return json_mem_calloc(items, size);
+}
+
+static void json_zlib_free(voidpf opaque, voidpf address)
+{
+    (void)opaque;
+    json_mem_free(address);
+}
+#endif
+
+// Sets up the codec of a stream. Returns 0 with errno set on failure.
+static int json_compressed_init_codec(struct json_compressed_stream *stream)
+{
+    switch (stream->compression)
+    {
+#ifdef LIBJSON_HAVE_ZLIB
+    case JSON_COMPRESSION_GZIP:
+    {
+        stream->gzip.zalloc = json_zlib_alloc;
+        stream->gzip.zfree = json_zlib_free;
+        // 16 selects the gzip wrapper instead of the zlib one
+        int ret = stream->writing
+                      ? deflateInit2(&stream->gzip, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY)
+                      : inflateInit2(&stream->gzip, 16 + MAX_WBITS);
+        if (ret != Z_OK)
+        {
+            stream->compression = JSON_COMPRESSION_NONE;
+            errno = ENOMEM;
+            return 0;
+        }
+        return 1;
+    }
+#endif
+#ifdef LIBJSON_HAVE_ZSTD
+    case JSON_COMPRESSION_ZSTD:
+        if (stream->writing)
+        {
+            stream->zstd_out = ZSTD_createCStream();
+            if (stream->zstd_out && !ZSTD_isError(ZSTD_initCStream(stream->zstd_out, 3)))
+                return 1;
+        }
+        else
+        {
+            stream->zstd_in = ZSTD_createDStream();
+            if (stream->zstd_in && !ZSTD_isError(ZSTD_initDStream(stream->zstd_in)))
+                return 1;
+        }
+        errno = ENOMEM;
+        return 0;
+#endif
+    case JSON_COMPRESSION_NONE:
+        return 1;
+    default:
+        errno = ENOTSUP;
+        return 0;
+    }
+}
+
+FILE *json_compressed_wrap(FILE *raw, const char *mode, enum json_compression compression)
+{
+    if (!raw || !mode || (mode[0] != 'r' && mode[0] != 'w'))
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (!json_compression_supported(compression))
+    {
+        errno = ENOTSUP;
+        return NULL;
+    }
+
+    struct json_compressed_stream *stream = json_mem_calloc(1, sizeof(struct json_compressed_stream));
+    if (!stream)
+        return NULL;
+    stream->raw = raw;
+    stream->writing = mode[0] == 'w';
+    if (compression == JSON_COMPRESSION_AUTO)
+        compression = stream->writing ? JSON_COMPRESSION_NONE : json_compressed_detect(stream);
+    stream->compression = compression;
+    if (!json_compression_supported(compression) || !json_compressed_init_codec(stream))
+    {
+        int error = json_compression_supported(compression) ? errno : ENOTSUP;
+        stream->compression = JSON_COMPRESSION_NONE;
+        json_compressed_free(stream);
+        errno = error;
+        return NULL;
+    }
+
+    cookie_io_functions_t io = {
+        .read = stream->writing ? NULL : json_compressed_read,
+        .write = stream->writing ? json_compressed_write : NULL,
+        .seek = NULL,
+        .close = json_compressed_close};
+
+    if (!stream->writing)
+    {
+        stream->blocks = json_mem_alloc(LIBJSON_COMPRESSED_BLOCKS * sizeof(struct json_compressed_block));
+        if (!stream->blocks)
+        {
+            json_compressed_free(stream);
+            errno = ENOMEM;
+            return NULL;
+        }
+        pthread_mutex_init(&stream->lock, NULL);
+        pthread_cond_init(&stream->cond, NULL);
+        if (pthread_create(&stream->thread, NULL, json_decompress_thread, stream) != 0)
+        {
+            pthread_cond_destroy(&stream->cond);
+            pthread_mutex_destroy(&stream->lock);
+            json_compressed_free(stream);
+            errno = EAGAIN;
+            return NULL;
+        }
+    }
+
+    FILE *file = fopencookie(stream, stream->writing ? "w" : "r", io);
+    if (!file)
+    {
+        // Closing releases the codec and the thread, but the caller keeps raw
+        stream->raw = NULL;
+        int error = errno;
+        if (!stream->writing)
+        {
+            pthread_mutex_lock(&stream->lock);
+            stream->closing = 1;
+            pthread_cond_broadcast(&stream->cond);
+            pthread_mutex_unlock(&stream->lock);
+            pthread_join(stream->thread, NULL);
+        }
+        json_compressed_free(stream);
+        errno = error;
+        return NULL;
+    }
+    // Move data between the stream and its user in large blocks
+    setvbuf(file, NULL, _IOFBF, LIBJSON_COMPRESSED_BLOCK_SIZE);
+    return file;
+}
+
+static enum json_compression json_compression_from_path(const char *path)
+{
+    size_t length = strlen(path);
+    if (length > 3 && strcmp(path + length - 3, ".gz") == 0)
+        return JSON_COMPRESSION_GZIP;
+    if (length > 4 && strcmp(path + length - 4, ".zst") == 0)
+        return JSON_COMPRESSION_ZSTD;
+    return JSON_COMPRESSION_NONE;
+}
+
+FILE *json_compressed_fopen(const char *path, const char *mode, enum json_compression compression)
+{
+    if (!path || !mode || (mode[0] != 'r' && mode[0] != 'w'))
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (compression == JSON_COMPRESSION_AUTO && mode[0] == 'w')
+        compression = json_compression_from_path(path);
+    if (!json_compression_supported(compression))
+    {
+        errno = ENOTSUP;
+        return NULL;
+    }
+
+    FILE *raw = fopen(path, mode[0] == 'w' ? "wb" : "rb");
+    if (!raw)
+        return NULL;
+    FILE *file = json_compressed_wrap(raw, mode, compression);
+    if (!file)
+    {
+        int error = errno;
+        fclose(raw);
+        errno = error;
+    }
+    return file;
+}
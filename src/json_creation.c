@@ -19,30 +19,180 @@ struct json *json_false()
     return &json_false_value;
 }
 
-struct json *json_number(double value)
+// Allocates a node from the arena, or from the slabs without one, with no raw
+// text
+struct json *json_node_new(struct json_arena *arena, json_type type)
+{
+    struct json *node = arena ? json_arena_alloc(arena, sizeof(struct json)) : slab_alloc(sizeof(struct json));
+    if (!node)
+        return NULL;
+
+    node->type = type;
+    node->inline_size = 0;
+    node->flags = arena ? JSON_NODE_ARENA : 0;
+    node->refs = 1;
+    node->raw = NULL;
+    return node;
+}
+
+void json_node_free(struct json *node)
+{
+    if (!(node->flags & JSON_NODE_ARENA))
+        slab_free(node, sizeof(struct json));
+}
+
+struct json *json_number_new(struct json_arena *arena, double value)
 {
-    struct json *node = (struct json *)malloc(sizeof(struct json));
+    struct json *node = json_node_new(arena, JSON_NUMBER);
     if (!node)
         return NULL;
 
-    node->type = JSON_NUMBER;
     node->value.number = value;
     return node;
 }
 
+struct json *json_number(double value)
+{
+    return json_number_new(NULL, value);
+}
+
+// Takes ownership of the literal text, which is only converted on access
+struct json *json_number_literal(struct json_arena *arena, char *text)
+{
+    struct json *node = json_node_new(arena, JSON_NUMBER);
+    if (!node)
+    {
+        json_mem_free(text);
+        return NULL;
+    }
+
+    node->value.number = 0.0;
+    node->raw = text;
+    if (arena)
+    {
+        node->raw = json_arena_strndup(arena, text, strlen(text));
+        json_mem_free(text);
+        if (!node->raw)
+            return NULL;
+    }
+    return node;
+}
+
+// Copies a short string into the node, or returns 0 if it does not fit
+static int json_string_store_inline(struct json *node, const char *value)
+{
+    size_t length = strlen(value);
+    if (length >= LIBJSON_INLINE_STRING_SIZE)
+    {
+        node->inline_size = 0;
+        return 0;
+    }
+    memcpy(node->inline_string, value, length + 1);
+    node->inline_size = (unsigned char)(length + 1);
+    return 1;
+}
+
+struct json *json_string_new(struct json_arena *arena, const char *value)
+{
+    struct json *node = json_node_new(arena, JSON_STRING);
+    if (!node)
+        return NULL;
+
+    if (json_string_store_inline(node, value))
+        return node;
+    node->raw = NULL;
+    node->value.string = arena ? json_arena_strndup(arena, value, strlen(value)) : json_mem_strdup(value);
+    if (!node->value.string)
+    {
+        json_node_free(node);
+        return NULL;
+    }
+    return node;
+}
+
 struct json *json_string(const char *value)
 {
     if (!value)
         return &json_null_value;
-    struct json *node = (struct json *)malloc(sizeof(struct json));
+    return json_string_new(NULL, value);
+}
+
+// Copies the buffers of a string into an arena and frees them. Escaped text is
+// decoded right away, since a value decoded on access would never be freed.
+static int json_string_move_to_arena(struct json_arena *arena, char **value, char **raw)
+{
+    char *decoded = *value ? *value : json_unescape(*raw, NULL);
+    char *value_copy = decoded ? json_arena_strndup(arena, decoded, strlen(decoded)) : NULL;
+    char *raw_copy = NULL;
+    if (*raw)
+        raw_copy = *raw == *value ? value_copy : json_arena_strndup(arena, *raw, strlen(*raw));
+
+    if (decoded != *value)
+        json_mem_free(decoded);
+    json_mem_free(*value);
+    if (*raw != *value)
+        json_mem_free(*raw);
+    *value = value_copy;
+    *raw = raw_copy;
+    return value_copy && (raw_copy || !*raw);
+}
+
+// Takes ownership of the decoded value and of the raw source text. A string
+// without escapes uses the same buffer for both, and an escaped one starts
+// with no decoded value until it is accessed.
+struct json *json_string_take(struct json_arena *arena, char *value, char *raw)
+{
+    if (!value && !raw)
+        return NULL;
+    struct json *node = json_node_new(arena, JSON_STRING);
     if (!node)
+    {
+        json_mem_free(value);
+        if (raw != value)
+            json_mem_free(raw);
         return NULL;
+    }
 
-    node->type = JSON_STRING;
-    node->value.string = strdup(value);
-    if (!node->value.string)
+    // Only decoded strings can be moved into the node, raw text is kept as is
+    if (!raw && json_string_store_inline(node, value))
     {
-        free(node);
+        json_mem_free(value);
+        return node;
+    }
+    if (arena && !json_string_move_to_arena(arena, &value, &raw))
+        return NULL;
+    node->value.string = value;
+    node->raw = raw;
+    return node;
+}
+
+// Arrays of an arena get their storage right away, so that it knows the arena
+struct json *json_array_new(struct json_arena *arena)
+{
+    struct json *node = json_node_new(arena, JSON_ARRAY);
+    if (!node)
+        return NULL;
+
+    node->value.array = NULL; // Empty array initially
+    if (arena)
+    {
+        node->value.array = vector_json_new(arena);
+        if (!node->value.array)
+            return NULL;
+    }
+    return node;
+}
+
+struct json *json_object_new(struct json_arena *arena)
+{
+    struct json *node = json_node_new(arena, JSON_OBJECT);
+    if (!node)
+        return NULL;
+
+    node->value.object = hash_table_new(arena);
+    if (!node->value.object)
+    {
+        json_node_free(node);
         return NULL;
     }
     return node;
@@ -50,12 +200,10 @@ struct json *json_string(const char *value)
 
 struct json *__json_array_macro(struct json *elements[])
 {
-    struct json *node = (struct json *)malloc(sizeof(struct json));
+    struct json *node = json_array_new(NULL);
     if (!node)
         return NULL;
 
-    node->type = JSON_ARRAY;
-    node->value.array = NULL; // Empty array initially
     while (elements && *elements)
     {
         json_array_push(node, *elements);
@@ -66,138 +214,234 @@ struct json *__json_array_macro(struct json *elements[])
 
 struct json *__json_object_macro(struct json_key_value elements[])
 {
-    struct json *node = (struct json *)malloc(sizeof(struct json));
+    struct json *node = json_object_new(NULL);
     if (!node)
         return NULL;
 
-    node->type = JSON_OBJECT;
-    node->value.object = hash_table_new();
-    if (!node->value.object)
-    {
-        free(node);
-        return NULL;
-    }
     while (elements && elements->key)
     {
-        struct json *value = elements->value;
-        hash_table_set(node->value.object, elements->key, value);
+        hash_table_set(node->value.object, elements->key, json_cell_from_node(elements->value));
         elements++;
     }
     return node;
 }
 
-struct json *json_copy(struct json *json)
+// Deep copy of a scalar, for the nodes that cannot be shared
+static struct json *json_copy_scalar(struct json *json)
 {
-    // Null and singleton static values can be returned directly
-    if (!json || json == &json_null_value || json == &json_true_value || json == &json_false_value)
-        return json;
-
-    struct json *copy = (struct json *)malloc(sizeof(struct json));
+    // Copies never belong to an arena
+    struct json *copy = json_node_new(NULL, json->type);
     if (!copy)
         return NULL;
 
-    copy->type = json->type;
+    // Strings stored in the node are copied along with it
+    if (json->inline_size)
+    {
+        *copy = *json;
+        copy->flags = 0;
+        copy->refs = 1;
+        return copy;
+    }
+
     switch (json->type)
     {
-    case JSON_NULL:
-        // This case should not happen since static values are returned early
-        break;
-    case JSON_BOOLEAN:
-        copy->value.boolean = json->value.boolean;
-        break;
     case JSON_NUMBER:
         copy->value.number = json->value.number;
+        if (json->raw)
+        {
+            copy->raw = json_mem_strdup(json->raw);
+            if (!copy->raw)
+            {
+                json_node_free(copy);
+                return NULL;
+            }
+        }
         break;
     case JSON_STRING:
-        copy->value.string = strdup(json->value.string);
-        if (!copy->value.string)
+        copy->value.string = json->value.string ? json_mem_strdup(json->value.string) : NULL;
+        if (json->raw)
+            copy->raw = json->raw == json->value.string ? copy->value.string : json_mem_strdup(json->raw);
+        if ((json->value.string && !copy->value.string) || (json->raw && !copy->raw))
         {
-            free(copy);
+            json_mem_free(copy->value.string);
+            if (copy->raw != copy->value.string)
+                json_mem_free(copy->raw);
+            json_node_free(copy);
             return NULL;
         }
         break;
-    case JSON_ARRAY:
+    default:
+        copy->value = json->value;
+        break;
+    }
+    return copy;
+}
+
+struct json *json_copy(struct json *json)
+{
+    // Null and singleton static values can be returned directly
+    if (!json || json_is_singleton(json))
+        return json;
+
+    int shareable = json_is_shareable(json);
+    if (json->type != JSON_ARRAY && json->type != JSON_OBJECT)
     {
-        struct linked_list_json_iter *ll_iter = linked_list_json_iter_new(json->value.array);
-        if (!ll_iter)
+        // Scalars are never modified, so copies are the same node
+        if (!shareable)
+            return json_copy_scalar(json);
+        json_refs_retain(&json->refs);
+        return json;
+    }
+
+    // Copied containers get a node of their own, which shares the storage of
+    // the original until either of them is modified. Storage that holds
+    // arrays or objects is cloned instead, so that the nested containers the
+    // getters hand out get nodes of their own as well, down to the ones that
+    // only hold scalars.
+    struct json *copy = json_node_new(NULL, json->type);
+    if (!copy)
+        return NULL;
+    if (json->type == JSON_ARRAY)
+    {
+        if (shareable && !vector_json_deep(json->value.array))
+            copy->value.array = vector_json_share(json->value.array);
+        else if (!(copy->value.array = vector_json_clone(json->value.array, json_cell_copy, json_cell_free)))
         {
-            free(copy);
+            json_node_free(copy);
             return NULL;
         }
-        copy->value.array = NULL;
-        struct json *element;
-        while ((element = linked_list_json_iter_next(ll_iter)))
-        {
-            struct json *element_copy = json_copy(element);
-            if (!element_copy)
-            {
-                linked_list_json_iter_free(ll_iter);
-                linked_list_json_free(copy->value.array);
-                free(copy);
-                return NULL;
-            }
-            json_array_push(copy, element_copy);
-        }
-        linked_list_json_iter_free(ll_iter);
-        break;
     }
-    case JSON_OBJECT:
+    else
     {
-        copy->value.object = hash_table_new();
-        struct hash_table_iter *ht_iter = hash_table_iter_new(json->value.object);
-        if (!copy->value.object || !ht_iter)
+        if (shareable && !hash_table_deep(json->value.object))
+            copy->value.object = hash_table_share(json->value.object);
+        else if (!(copy->value.object = hash_table_clone(json->value.object, json_cell_copy, json_cell_free)))
         {
-            free(copy);
+            json_node_free(copy);
             return NULL;
         }
-        struct hash_table_entry *entry;
-        while ((entry = hash_table_iter_next(ht_iter)))
-        {
-            struct json *value_copy = json_copy((struct json *)hash_table_entry_value(entry));
-            if (!value_copy)
-            {
-                hash_table_iter_free(ht_iter);
-                hash_table_free(copy->value.object, (free_func)json_free);
-                free(copy);
-                return NULL;
-            }
-            hash_table_set(copy->value.object, hash_table_entry_key(entry), value_copy);
-        }
-        hash_table_iter_free(ht_iter);
-        break;
-    }
     }
     return copy;
 }
 
+// Gives a container storage of its own before it is modified, by cloning
+// shared storage. Shared storage only holds scalars, which the clone shares
+// in turn. Returns 0 if out of memory.
+int json_unshare(struct json *container)
+{
+    if (container->type == JSON_ARRAY && vector_json_shared(container->value.array))
+    {
+        struct vector_json *clone = vector_json_clone(container->value.array, json_cell_copy, json_cell_free);
+        if (!clone)
+            return 0;
+        struct json old = *container;
+        container->value.array = clone;
+        json_free_value(&old);
+    }
+    else if (container->type == JSON_OBJECT && hash_table_shared(container->value.object))
+    {
+        struct hash_table *clone = hash_table_clone(container->value.object, json_cell_copy, json_cell_free);
+        if (!clone)
+            return 0;
+        struct json old = *container;
+        container->value.object = clone;
+        json_free_value(&old);
+    }
+    return 1;
+}
+
 void json_free(struct json *json)
 {
-    if (!json || json == &json_null_value || json == &json_true_value || json == &json_false_value)
+    // Values of an arena are only released with it
+    if (!json || json_is_singleton(json) || (json->flags & JSON_NODE_ARENA))
+        return;
+    // Shared scalars are released by their last owner
+    if (!json_refs_release(&json->refs))
         return;
 
+    json_free_value(json);
+    json_node_free(json);
+}
+
+// Frees what a node holds, or releases the storage it shares, but not the
+// node itself
+void json_free_value(struct json *json)
+{
     switch (json->type)
     {
     case JSON_ARRAY:
     {
+        if (json->value.array && !vector_json_release(json->value.array))
+            break;
         // Free all JSON elements in the array first
-        struct linked_list_json *current = json->value.array;
-        while (current)
-        {
-            json_free(linked_list_json_value(current));
-            current = linked_list_json_next(current);
-        }
-        // Then free the linked list structure
-        linked_list_json_free(json->value.array);
+        int length = vector_json_length(json->value.array);
+        for (int i = 0; i < length; i++)
+            json_cell_free(*vector_json_get(json->value.array, i));
+        // Then free the vector itself
+        vector_json_free(json->value.array);
         break;
     }
     case JSON_OBJECT:
-        hash_table_free(json->value.object, (free_func)json_free);
+        if (hash_table_release(json->value.object))
+            hash_table_free(json->value.object, json_cell_free);
         break;
     case JSON_STRING:
-        free(json->value.string);
+        if (json->inline_size)
+            return;
+        if (json->raw == json->value.string)
+            json->raw = NULL;
+        json_mem_free(json->value.string);
         break;
     default:
         break;
     }
-    free(json);
+    json_mem_free(json->raw);
+}
+
+/**
+ * @subsection Cell functions
+ */
+
+// Returns the node of a cell, and turns an inline number into a node the
+// first time, so that the cell owns the same node from then on. The node is
+// allocated from the arena of the container, if any. Getters of several
+// threads may box the same cell: the node is published with a compare and
+// swap, and the threads that lose the race free theirs.
+struct json *json_cell_box(json_cell *cell, struct json_arena *arena)
+{
+    json_cell current = json_cell_load(cell);
+    if (json_cell_is_node(current))
+        return json_cell_node(current);
+
+    struct json *node = json_number_new(arena, json_cell_number(current));
+    if (!node)
+        return NULL;
+    json_cell boxed = json_cell_from_node(node);
+    if (__atomic_compare_exchange_n(cell, &current, boxed, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        return node;
+    // Nodes of an arena are released with it
+    json_free(node);
+    return json_cell_node(current);
+}
+
+void json_cell_free(json_cell cell)
+{
+    if (json_cell_is_node(cell))
+        json_free(json_cell_node(cell));
+}
+
+// Inline numbers are copied as they are, nodes with json_copy()
+int json_cell_copy(json_cell cell, json_cell *copy)
+{
+    if (!json_cell_is_node(cell))
+    {
+        *copy = cell;
+        return 1;
+    }
+    struct json *node = json_cell_node(cell);
+    struct json *node_copy = json_copy(node);
+    if (node && !node_copy)
+        return 0;
+    *copy = json_cell_from_node(node_copy);
+    return 1;
 }
@@ -0,0 +1,314 @@
+#include "json_internal.h"
+#include "libjson/json_document.h"
+
+/**
+ * @section Incremental document parsing functions
+ */
+
+struct json_document
+{
+    struct json *root;
+    struct json_span *span; // span of the root, with an absolute start
+    enum json_syntax syntax;
+    size_t length;
+};
+
+struct json_span *json_span_open(struct error_context *errctx, const struct json_token *token)
+{
+    struct json_span_builder *spans = errctx->spans;
+    if (!spans || spans->failed)
+        return NULL;
+
+    struct json_span *span = json_mem_calloc(1, sizeof(struct json_span));
+    if (!span)
+    {
+        spans->failed = 1;
+        return NULL;
+    }
+    // Absolute until the span is closed
+    span->start = token->start;
+    span->parent = spans->current;
+    if (span->parent)
+    {
+        struct json_span *parent = span->parent;
+        if (parent->count == parent->capacity)
+        {
+            size_t capacity = parent->capacity ? parent->capacity * 2 : 4;
+            struct json_span **children = json_mem_realloc(parent->children, capacity * sizeof(struct json_span *));
+            if (!children)
+            {
+                json_mem_free(span);
+                spans->failed = 1;
+                return NULL;
+            }
+            parent->children = children;
+            parent->capacity = capacity;
+        }
+        parent->children[parent->count++] = span;
+    }
+    else
+    {
+        spans->root = span;
+    }
+    spans->current = span;
+    return span;
+}
+
+void json_span_close(struct error_context *errctx, struct json_span *span, struct json *node)
+{
+    if (!span)
+        return;
+
+    errctx->spans->current = span->parent;
+    if (!node)
+    {
+        // Not a value, like the end of an empty array: drop the span, which
+        // is the last one of its parent
+        if (span->parent)
+            span->parent->count--;
+        else
+            errctx->spans->root = NULL;
+        json_span_free(span);
+        return;
+    }
+    span->node = node;
+    if (!json_is_singleton(node))
+        node->flags |= JSON_NODE_DOCUMENT;
+    span->length = errctx->offset - span->start;
+    for (size_t i = 0; i < span->count; i++)
+        span->children[i]->start -= span->start;
+}
+
+void json_span_free(struct json_span *span)
+{
+    if (!span)
+        return;
+    for (size_t i = 0; i < span->count; i++)
+        json_span_free(span->children[i]);
+    json_mem_free(span->children);
+    json_mem_free(span);
+}
+
+// Parses text holding a single value and records its spans. Returns the span
+// of the value, which starts where the value does, or NULL on error.
+static struct json_span *json_document_read(const char *text, size_t length, enum json_syntax syntax, char *errbuf)
+{
+    struct json_token (*read_token)(FILE *, struct error_context *) = json_read_token;
+    int (*parse)(FILE *, struct json_token *, struct json **, struct error_context *) = json_parser_json;
+    if (syntax == JSON_SYNTAX_JSON5)
+    {
+        read_token = json5_read_token;
+        parse = json5_parser_json;
+    }
+
+    FILE *in = fmemopen((void *)text, length, "r");
+    if (!in)
+    {
+        strcpy(errbuf, "Could not open the document text.");
+        return NULL;
+    }
+    struct json_span_builder spans = {0};
+    struct error_context errctx = {
+        .message = errbuf,
+        .line = 0,
+        .column = 0,
+        .offset = 0,
+        .options = NULL,
+        .spans = &spans};
+    struct json *result = NULL;
+    struct json_token token = read_token(in, &errctx);
+    int parsed = token.type != JSON_TOKEN_INVALID && parse(in, &token, &result, &errctx);
+    if (parsed)
+    {
+        token = read_token(in, &errctx);
+        if (token.type != JSON_TOKEN_EOF)
+        {
+            if (token.type != JSON_TOKEN_INVALID)
+                strcpy(errbuf, "Unexpected data after the value.");
+            parsed = 0;
+        }
+        else if (spans.failed)
+        {
+            strcpy(errbuf, "Out of memory.");
+            parsed = 0;
+        }
+    }
+    fclose(in);
+
+    if (parsed)
+    {
+        errbuf[0] = '\0';
+        return spans.root;
+    }
+    // Error paths leave the token they stopped at, since edits are parsed
+    // again on every change
+    json_mem_free(token.value);
+    char linecol[64];
+    sprintf(linecol, "(%d:%d): ", errctx.line + 1, errctx.column);
+    strprep(errctx.message, linecol);
+    strprep(errctx.message, syntax == JSON_SYNTAX_JSON5 ? "Error parsing JSON5 " : "Error parsing JSON ");
+    json_free(result);
+    json_span_free(spans.root);
+    return NULL;
+}
+
+// Moves a freshly parsed value into an existing node, so that pointers to the
+// node stay valid, and releases what the node held before. Singletons are
+// compared by address, so they are never moved into a node.
+static void json_document_adopt(struct json *node, struct json *fresh)
+{
+    struct json old = *node;
+    *node = *fresh;
+    json_node_free(fresh);
+    json_free_value(&old);
+}
+
+// Re-parses the smallest value enclosing the edit within the given span.
+// Returns 0 if the span does not enclose the edit or the text of the value is
+// no longer a value on its own, leaving the span unchanged.
+static int json_document_reparse(struct json_document *document, struct json_span *span, long long start, const struct json_edit *edit, const char *text)
+{
+    long long end = start + span->length;
+    long long edit_start = edit->offset;
+    long long edit_end = edit->offset + edit->removed;
+    long long delta = (long long)edit->inserted_length - (long long)edit->removed;
+    int container = json_is_array(span->node) || json_is_object(span->node);
+
+    // The brackets of a container must be left untouched, while a scalar may
+    // be changed from end to end
+    if (container ? (edit_start <= start || edit_end >= end) : (edit_start < start || edit_end > end))
+        return 0;
+
+    // Values are separated by punctuation, so at most one child encloses the
+    // edit: the last one starting before it
+    size_t low = 0, high = span->count;
+    while (low < high)
+    {
+        size_t mid = low + (high - low) / 2;
+        if (start + span->children[mid]->start <= edit_start)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    if (low > 0)
+    {
+        struct json_span *child = span->children[low - 1];
+        if (json_document_reparse(document, child, start + child->start, edit, text))
+        {
+            for (size_t i = low; i < span->count; i++)
+                span->children[i]->start += delta;
+            span->length += delta;
+            return 1;
+        }
+    }
+
+    // Singletons are shared, so they can only be replaced by their parent
+    if (json_is_singleton(span->node))
+        return 0;
+
+    char errbuf[LIBJSON_ERRBUF_SiZE];
+    long long length = span->length + delta;
+    struct json_span *fresh = json_document_read(text + start, length, document->syntax, errbuf);
+    if (!fresh)
+        return 0;
+    // Whitespace or comments were added around the value, or it became a
+    // singleton, which only its parent can hold
+    if (fresh->start != 0 || fresh->length != length || json_is_singleton(fresh->node))
+    {
+        json_free(fresh->node);
+        json_span_free(fresh);
+        return 0;
+    }
+
+    json_document_adopt(span->node, fresh->node);
+    for (size_t i = 0; i < span->count; i++)
+        json_span_free(span->children[i]);
+    json_mem_free(span->children);
+    span->children = fresh->children;
+    span->count = fresh->count;
+    span->capacity = fresh->capacity;
+    for (size_t i = 0; i < span->count; i++)
+        span->children[i]->parent = span;
+    span->length = length;
+    json_mem_free(fresh);
+    return 1;
+}
+
+struct json_document *json_document_parse(const char *text, size_t length, enum json_syntax syntax, char *errbuf)
+{
+    if (!text)
+        return NULL;
+    if (!errbuf)
+        errbuf = __default_errbuf;
+
+    struct json_document *document = json_mem_alloc(sizeof(struct json_document));
+    if (!document)
+        return NULL;
+    document->span = json_document_read(text, length, syntax, errbuf);
+    if (!document->span)
+    {
+        json_mem_free(document);
+        return NULL;
+    }
+    document->root = document->span->node;
+    document->syntax = syntax;
+    document->length = length;
+    return document;
+}
+
+int json_document_edit(struct json_document *document, const struct json_edit *edit, const char *text, size_t length, char *errbuf)
+{
+    if (!document || !edit || !text)
+        return 0;
+    if (!errbuf)
+        errbuf = __default_errbuf;
+    if (edit->offset > document->length || edit->removed > document->length - edit->offset ||
+        length != document->length - edit->removed + edit->inserted_length)
+    {
+        strcpy(errbuf, "Edit does not match the length of the document.");
+        return 0;
+    }
+    document->length = length;
+
+    if (document->span && json_document_reparse(document, document->span, document->span->start, edit, text))
+    {
+        errbuf[0] = '\0';
+        return 1;
+    }
+
+    // The edit reaches the root: parse the whole text again
+    struct json_span *span = json_document_read(text, length, document->syntax, errbuf);
+    json_span_free(document->span);
+    document->span = span;
+    if (!span)
+    {
+        json_free(document->root);
+        document->root = NULL;
+        return 0;
+    }
+    if (document->root && !json_is_singleton(document->root) && !json_is_singleton(span->node))
+    {
+        json_document_adopt(document->root, span->node);
+        span->node = document->root;
+    }
+    else
+    {
+        json_free(document->root);
+        document->root = span->node;
+    }
+    return 1;
+}
+
+struct json *json_document_root(const struct json_document *document)
+{
+    return document ? document->root : NULL;
+}
+
+void json_document_free(struct json_document *document)
+{
+    if (!document)
+        return;
+    json_span_free(document->span);
+    json_free(document->root);
+    json_mem_free(document);
+}
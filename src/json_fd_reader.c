@@ -0,0 +1,316 @@
+#include "json_internal.h"
+
+#include <errno.h>
+#include <unistd.h>
+
+/**
+ * @section JSON file descriptor reading functions
+ */
+
+// Size of the ring buffer, and so of the largest read() call, when created
+#define LIBJSON_FD_READER_CAPACITY (1 << 16)
+
+// Progress of the value being delimited in the buffer
+enum json_frame_state
+{
+    JSON_FRAME_NONE,      // between values
+    JSON_FRAME_CONTAINER, // inside an object or array
+    JSON_FRAME_STRING,    // inside a top-level string
+    JSON_FRAME_SCALAR     // inside a top-level number or literal
+};
+
+struct json_fd_reader
+{
+    int fd;
+    struct json_read_options options;
+    // Ring buffer indexed by absolute positions masked by capacity - 1
+    char *ring;
+    size_t capacity;
+    size_t head; // start of the value being delimited
+    size_t scan; // next byte to delimit
+    size_t tail; // end of the buffered input
+    int eof;
+    // Delimiting state of the current value
+    enum json_frame_state state;
+    int depth;
+    int in_string;
+    int escaped;
+    // Contiguous copy of values that wrap around the ring
+    char *scratch;
+    size_t scratch_capacity;
+    long long offset;
+};
+
+struct json_fd_reader *json_fd_reader_new(int fd, const struct json_read_options *options)
+{
+    if (fd < 0)
+        return NULL;
+    struct json_fd_reader *reader = json_mem_alloc(sizeof(struct json_fd_reader));
+    if (!reader)
+        return NULL;
+    reader->ring = json_mem_alloc(LIBJSON_FD_READER_CAPACITY);
+    if (!reader->ring)
+    {
+        json_mem_free(reader);
+        return NULL;
+    }
+
+    reader->fd = fd;
+    if (options)
+        reader->options = *options;
+    else
+        memset(&reader->options, 0, sizeof(reader->options));
+    reader->capacity = LIBJSON_FD_READER_CAPACITY;
+    reader->head = reader->scan = reader->tail = 0;
+    reader->eof = 0;
+    reader->state = JSON_FRAME_NONE;
+    reader->depth = reader->in_string = reader->escaped = 0;
+    reader->scratch = NULL;
+    reader->scratch_capacity = 0;
+    reader->offset = 0;
+    return reader;
+}
+
+void json_fd_reader_free(struct json_fd_reader *reader)
+{
+    if (!reader)
+        return;
+    json_mem_free(reader->ring);
+    json_mem_free(reader->scratch);
+    json_mem_free(reader);
+}
+
+long long json_fd_reader_offset(const struct json_fd_reader *reader)
+{
+    return reader ? reader->offset : 0;
+}
+
+// Moves the buffered bytes to the start of a ring of another capacity
+static int json_fd_reader_resize(struct json_fd_reader *reader, size_t capacity)
+{
+    size_t length = reader->tail - reader->head;
+    char *ring = json_mem_alloc(capacity);
+    if (!ring)
+        return 0;
+    for (size_t i = 0; i < length; i++)
+        ring[i] = reader->ring[(reader->head + i) & (reader->capacity - 1)];
+    json_mem_free(reader->ring);
+    reader->ring = ring;
+    reader->capacity = capacity;
+    reader->scan -= reader->head;
+    reader->tail = length;
+    reader->head = 0;
+    return 1;
+}
+
+// Gives back the memory of a ring grown for a large value once the buffered
+// bytes fit in the initial capacity again
+static void json_fd_reader_shrink(struct json_fd_reader *reader)
+{
+    if (reader->capacity > LIBJSON_FD_READER_CAPACITY && reader->tail - reader->head <= LIBJSON_FD_READER_CAPACITY)
+        json_fd_reader_resize(reader, LIBJSON_FD_READER_CAPACITY);
+    if (reader->scratch_capacity > LIBJSON_FD_READER_CAPACITY)
+    {
+        json_mem_free(reader->scratch);
+        reader->scratch = NULL;
+        reader->scratch_capacity = 0;
+    }
+}
+
+// Fills the free space of the ring with a single read() call. Returns the
+// byte count, 0 at end of stream or -1 with errno set.
+static ssize_t json_fd_reader_fill(struct json_fd_reader *reader)
+{
+    if (reader->tail - reader->head == reader->capacity && !json_fd_reader_resize(reader, reader->capacity * 2))
+    {
+        errno = ENOMEM;
+        return -1;
+    }
+    size_t mask = reader->capacity - 1;
+    size_t start = reader->tail & mask;
+    size_t free_space = reader->capacity - (reader->tail - reader->head);
+    size_t contiguous = reader->capacity - start;
+    ssize_t n;
+    do
+    {
+        n = read(reader->fd, reader->ring + start, contiguous < free_space ? contiguous : free_space);
+    } while (n < 0 && errno == EINTR);
+    if (n > 0)
+        reader->tail += n;
+    return n;
+}
+
+static int json_is_scalar_delimiter(int c)
+{
+    return isspace(c) || c == LIBJSON_RECORD_SEPARATOR || strchr("{}[],:\"", c);
+}
+
+// Advances the delimiting state over the buffered bytes. Returns 1 once the
+// current value is complete, with scan right after its last byte.
+static int json_fd_reader_delimit(struct json_fd_reader *reader)
+{
+    size_t mask = reader->capacity - 1;
+    while (reader->scan < reader->tail)
+    {
+        unsigned char c = reader->ring[reader->scan & mask];
+        switch (reader->state)
+        {
+        case JSON_FRAME_NONE:
+            if (isspace(c) || c == LIBJSON_RECORD_SEPARATOR)
+            {
+                // Separators are consumed without being part of any value
+                reader->head = ++reader->scan;
+                reader->offset++;
+                continue;
+            }
+            if (c == '{' || c == '[')
+            {
+                reader->state = JSON_FRAME_CONTAINER;
+                reader->depth = 1;
+            }
+            else if (c == '"')
+            {
+                reader->state = JSON_FRAME_STRING;
+                reader->in_string = 1;
+            }
+            else
+            {
+                reader->state = JSON_FRAME_SCALAR;
+            }
+            reader->scan++;
+            continue;
+        case JSON_FRAME_SCALAR:
+            if (json_is_scalar_delimiter(c))
+                return 1;
+            reader->scan++;
+            continue;
+        default:
+            break;
+        }
+
+        reader->scan++;
+        if (reader->in_string)
+        {
+            if (reader->escaped)
+                reader->escaped = 0;
+            else if (c == '\\')
+                reader->escaped = 1;
+            else if (c == '"')
+            {
+                reader->in_string = 0;
+                if (reader->state == JSON_FRAME_STRING)
+                    return 1;
+            }
+        }
+        else if (c == '"')
+            reader->in_string = 1;
+        else if (c == '{' || c == '[')
+            reader->depth++;
+        else if ((c == '}' || c == ']') && --reader->depth == 0)
+            return 1;
+    }
+    return 0;
+}
+
+// Parses the delimited value and drops it from the buffer
+static struct json *json_fd_reader_parse(struct json_fd_reader *reader, char *errbuf)
+{
+    size_t mask = reader->capacity - 1;
+    size_t length = reader->scan - reader->head;
+    size_t start = reader->head & mask;
+    const char *text = reader->ring + start;
+    struct json *result = NULL;
+
+    if (start + length > reader->capacity)
+    {
+        if (length > reader->scratch_capacity)
+        {
+            char *scratch = json_mem_realloc(reader->scratch, length);
+            if (!scratch)
+            {
+                strcpy(errbuf, "Out of memory.");
+                goto done;
+            }
+            reader->scratch = scratch;
+            reader->scratch_capacity = length;
+        }
+        size_t first = reader->capacity - start;
+        memcpy(reader->scratch, text, first);
+        memcpy(reader->scratch + first, reader->ring, length - first);
+        text = reader->scratch;
+    }
+
+    FILE *memfile = fmemopen((void *)text, length, "r");
+    if (!memfile)
+    {
+        strcpy(errbuf, "Out of memory.");
+        goto done;
+    }
+    struct error_context errctx = {
+        .message = errbuf,
+        .line = 0,
+        .column = 0,
+        .offset = 0,
+        .options = &reader->options};
+    result = json_read_value(memfile, &errctx);
+    fclose(memfile);
+    if (result && errctx.offset != (long long)length)
+    {
+        json_free(result);
+        result = NULL;
+        sprintf(errbuf, "Error parsing JSON at offset %lld: Unexpected data after value.", reader->offset + errctx.offset);
+    }
+
+done:
+    reader->head = reader->scan;
+    reader->offset += length;
+    reader->state = JSON_FRAME_NONE;
+    reader->depth = reader->in_string = reader->escaped = 0;
+    json_fd_reader_shrink(reader);
+    return result;
+}
+
+enum json_read_status json_fd_reader_next(struct json_fd_reader *reader, struct json **dest, char *errbuf)
+{
+    if (!reader || !dest)
+        return JSON_READ_ERROR;
+    if (!errbuf)
+        errbuf = __default_errbuf;
+    *dest = NULL;
+    errbuf[0] = '\0';
+
+    while (!json_fd_reader_delimit(reader))
+    {
+        if (reader->eof)
+        {
+            if (reader->state == JSON_FRAME_SCALAR)
+                break; // The end of the stream delimits a top-level scalar
+            if (reader->state == JSON_FRAME_NONE)
+                return JSON_READ_EOF;
+            sprintf(errbuf, "Error parsing JSON at offset %lld: Unexpected end of stream.", reader->offset);
+            // The incomplete value is dropped, but still counted as consumed
+            reader->offset += reader->tail - reader->head;
+            reader->head = reader->scan = reader->tail;
+            reader->state = JSON_FRAME_NONE;
+            reader->depth = reader->in_string = reader->escaped = 0;
+            json_fd_reader_shrink(reader);
+            return JSON_READ_ERROR;
+        }
+
+        ssize_t n = json_fd_reader_fill(reader);
+        if (n == 0)
+        {
+            reader->eof = 1;
+        }
+        else if (n < 0)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return JSON_READ_AGAIN;
+            sprintf(errbuf, "Error reading JSON: %s", strerror(errno));
+            return JSON_READ_ERROR;
+        }
+    }
+
+    *dest = json_fd_reader_parse(reader, errbuf);
+    return *dest ? JSON_READ_VALUE : JSON_READ_ERROR;
+}
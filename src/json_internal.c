@@ -1,9 +1,9 @@
 #include "json_internal.h"
 
 // Static JSON singleton values
-struct json json_null_value = {.type = JSON_NULL, .value = {0}};
-struct json json_true_value = {.type = JSON_BOOLEAN, .value = {.boolean = 1}};
-struct json json_false_value = {.type = JSON_BOOLEAN, .value = {.boolean = 0}};
+struct json json_null_value = {.type = JSON_NULL, .refs = 1, .value = {0}, .raw = NULL};
+struct json json_true_value = {.type = JSON_BOOLEAN, .refs = 1, .value = {.boolean = 1}, .raw = NULL};
+struct json json_false_value = {.type = JSON_BOOLEAN, .refs = 1, .value = {.boolean = 0}, .raw = NULL};
 
 // The default error buffer to store error when no error buffer is provided.
 char __default_errbuf[LIBJSON_ERRBUF_SiZE];
@@ -20,10 +20,12 @@ void strprep(char *dst, const char *src)
 }
 
 // Helper for error handling
-int update_error_context(struct error_context *errctx, const char c, int index)
+int update_error_context(struct error_context *errctx, int c, int index)
 {
     if (errctx)
     {
+        if (c != EOF)
+            errctx->offset++;
         if (c == '\n' || c == '\r')
         {
             errctx->line++;
@@ -37,7 +39,157 @@ int update_error_context(struct error_context *errctx, const char c, int index)
         {
             errctx->column++;
         }
-        errctx->message[index] = c;
+        if (index < LIBJSON_TOKEN_ECHO_MAX)
+            errctx->message[index] = (char)c;
     }
-    return (int)c;
+    return c;
+}
+
+// Pushes a character back to the stream, keeping the consumed byte count
+int json_ungetc(int c, FILE *in, struct error_context *errctx)
+{
+    if (c != EOF && errctx)
+        errctx->offset--;
+    return ungetc(c, in);
+}
+
+// Checks a number literal against the JSON number grammar:
+// -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+int json_number_literal_valid(const char *text)
+{
+    if (!text)
+        return 0;
+    if (*text == '-')
+        text++;
+    if (*text == '0')
+        text++;
+    else if (isdigit((unsigned char)*text))
+        while (isdigit((unsigned char)*text))
+            text++;
+    else
+        return 0;
+    if (*text == '.')
+    {
+        text++;
+        if (!isdigit((unsigned char)*text))
+            return 0;
+        while (isdigit((unsigned char)*text))
+            text++;
+    }
+    if (*text == 'e' || *text == 'E')
+    {
+        text++;
+        if (*text == '+' || *text == '-')
+            text++;
+        if (!isdigit((unsigned char)*text))
+            return 0;
+        while (isdigit((unsigned char)*text))
+            text++;
+    }
+    return *text == '\0';
+}
+
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    return c - 'A' + 10;
+}
+
+static unsigned long unescape_hex4(const char *hex)
+{
+    return (hex_value(hex[0]) << 12) | (hex_value(hex[1]) << 8) | (hex_value(hex[2]) << 4) | hex_value(hex[3]);
+}
+
+// Encodes a code point as UTF-8 into at most 4 bytes, returning the count
+int utf8_encode(unsigned long codepoint, char *out)
+{
+    if (codepoint < 0x80)
+    {
+        out[0] = (char)codepoint;
+        return 1;
+    }
+    if (codepoint < 0x800)
+    {
+        out[0] = (char)(0xC0 | (codepoint >> 6));
+        out[1] = (char)(0x80 | (codepoint & 0x3F));
+        return 2;
+    }
+    if (codepoint < 0x10000)
+    {
+        out[0] = (char)(0xE0 | (codepoint >> 12));
+        out[1] = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (codepoint & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | (codepoint >> 18));
+    out[1] = (char)(0x80 | ((codepoint >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (codepoint & 0x3F));
+    return 4;
+}
+
+// Decodes the escape sequences of a string already validated by the
+// tokenizer. \uXXXX escapes, including surrogate pairs, are encoded as UTF-8.
+char *json_unescape(const char *raw, size_t *length)
+{
+    // Decoded text is never longer than the escaped text
+    char *decoded = json_mem_alloc(strlen(raw) + 1);
+    char *out = decoded;
+    if (!decoded)
+        return NULL;
+
+    while (*raw)
+    {
+        if (*raw != '\\')
+        {
+            *out++ = *raw++;
+            continue;
+        }
+        raw++;
+        switch (*raw++)
+        {
+        case 'b':
+            *out++ = '\b';
+            break;
+        case 'f':
+            *out++ = '\f';
+            break;
+        case 'n':
+            *out++ = '\n';
+            break;
+        case 'r':
+            *out++ = '\r';
+            break;
+        case 't':
+            *out++ = '\t';
+            break;
+        case 'u':
+        {
+            unsigned long codepoint = unescape_hex4(raw);
+            raw += 4;
+            if (codepoint >= 0xD800 && codepoint <= 0xDBFF && raw[0] == '\\' && raw[1] == 'u')
+            {
+                unsigned long low = unescape_hex4(raw + 2);
+                if (low >= 0xDC00 && low <= 0xDFFF)
+                {
+                    codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+                    raw += 6;
+                }
+            }
+            out += utf8_encode(codepoint, out);
+            break;
+        }
+        default: // '"', '\\' and '/' stand for themselves
+            *out++ = raw[-1];
+            break;
+        }
+    }
+    *out = '\0';
+    // \u0000 decodes to a NUL byte, so the length is not always strlen()
+    if (length)
+        *length = out - decoded;
+    return decoded;
 }
@@ -2,6 +2,7 @@
 #define LIBJSON_JSON_INTERNAL_H
 
 #include "libjson/json.h"
+#include "json_memory.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -9,93 +10,154 @@
 #include <math.h>
 #include <ctype.h>
 #include <stdarg.h>
+#include <stdint.h>
 
 /**
- * @brief Function pointer type for freeing values
+ * @brief Growable byte buffer, always kept NUL-terminated when taken
  */
-typedef void (*free_func)(void *);
+struct string_buffer
+{
+    char *data;
+    size_t length;
+    size_t capacity;
+};
 
 /**
- * @brief Function type for closures with function argument and context.
+ * @brief Array element or object value, NaN-boxed in 64 bits
+ *
+ * A cell holds either a double inline or a pointer to a node. Pointers are
+ * stored in the payload of a negative quiet NaN, a pattern that no double
+ * stored in a cell has since NaNs are canonicalized. User space addresses fit
+ * in the 48 bits of the payload on the supported 64-bit platforms.
  */
-typedef void *(*closure_func)(void *arg, void *ctx);
+typedef uint64_t json_cell;
 
-/**
- * @brief Function type for closures with function argument only.
- */
-typedef void *(*pure_func)(void *arg);
+#define LIBJSON_CELL_TAG_MASK 0xFFFF000000000000ULL
+#define LIBJSON_CELL_NODE_TAG 0xFFFC000000000000ULL
+#define LIBJSON_CELL_NAN 0x7FF8000000000000ULL
+
+static inline json_cell json_cell_from_node(const struct json *node)
+{
+    return LIBJSON_CELL_NODE_TAG | (uint64_t)(uintptr_t)node;
+}
+
+static inline json_cell json_cell_from_number(double value)
+{
+    json_cell cell;
+    if (value != value)
+        return LIBJSON_CELL_NAN;
+    memcpy(&cell, &value, sizeof(cell));
+    return cell;
+}
+
+static inline int json_cell_is_node(json_cell cell)
+{
+    return (cell & LIBJSON_CELL_TAG_MASK) == LIBJSON_CELL_NODE_TAG;
+}
+
+static inline struct json *json_cell_node(json_cell cell)
+{
+    return (struct json *)(uintptr_t)(cell & ~LIBJSON_CELL_TAG_MASK);
+}
+
+static inline double json_cell_number(json_cell cell)
+{
+    double value;
+    memcpy(&value, &cell, sizeof(value));
+    return value;
+}
+
+// Reads a cell that a getter of another thread may be boxing, see
+// json_cell_box()
+static inline json_cell json_cell_load(const json_cell *cell)
+{
+    return __atomic_load_n(cell, __ATOMIC_ACQUIRE);
+}
 
 /**
- * @brief Function type for closures with only args and no return value.
+ * @brief Atomic reference counts of shared nodes and container storage
+ *
+ * A count of 1 means the caller holds the only reference, which no other
+ * thread can take from it, so releasing it skips the atomic operation.
  */
-typedef void (*call_func)(void *arg);
+static inline void json_refs_retain(unsigned *refs)
+{
+    __atomic_fetch_add(refs, 1, __ATOMIC_RELAXED);
+}
+
+// Returns 1 if the released reference was the last one
+static inline int json_refs_release(unsigned *refs)
+{
+    if (__atomic_load_n(refs, __ATOMIC_ACQUIRE) == 1)
+        return 1;
+    return __atomic_sub_fetch(refs, 1, __ATOMIC_ACQ_REL) == 0;
+}
+
+static inline int json_refs_shared(const unsigned *refs)
+{
+    return __atomic_load_n(refs, __ATOMIC_ACQUIRE) > 1;
+}
 
 // Forward declarations for internal structures
-struct closure;
-struct linked_list;
-struct linked_list_json;
+struct json_arena;
+struct vector_json;
 struct hash_table;
 struct hash_table_entry;
-struct hash_table_iter;
-struct linked_list_iter;
-struct linked_list_json_iter;
-
-// ===== CLOSURE API =====
-struct closure *closure_pure(pure_func func);
-struct closure *closure_call(call_func func);
-struct closure *closure_new(closure_func func, void *ctx);
-void closure_free(struct closure *closure);
-void *closure_invoke(struct closure *closure, void *arg);
-
-// ===== LINKED LIST API =====
-struct linked_list *linked_list_new(void *value);
-int linked_list_length(struct linked_list *list);
-void linked_list_free(struct linked_list *list, free_func free_value);
-void linked_list_foreach(struct linked_list *list, struct closure *closure);
-struct linked_list *linked_list_insert(struct linked_list *last, void *value);
-void *linked_list_value(struct linked_list *node);
-struct linked_list *linked_list_next(struct linked_list *node);
-struct linked_list *linked_list_find(struct linked_list *node, struct closure *closure, struct linked_list **prev);
-void *linked_list_remove(struct linked_list *node, struct closure *closure, struct linked_list **prev);
-
-// Linked list iterator API
-struct linked_list_iter *linked_list_iter_new(struct linked_list *list);
-void *linked_list_iter_next(struct linked_list_iter *iter);
-int linked_list_iter_has_next(struct linked_list_iter *iter);
-void linked_list_iter_free(struct linked_list_iter *iter);
-
-// ===== JSON-SPECIFIC LINKED LIST API =====
-struct linked_list_json *linked_list_json_new(struct json *value);
-int linked_list_json_length(struct linked_list_json *list);
-void linked_list_json_free(struct linked_list_json *list);
-struct linked_list_json *linked_list_json_insert(struct linked_list_json *last, struct json *value);
-struct json *linked_list_json_value(struct linked_list_json *node);
-struct linked_list_json *linked_list_json_next(struct linked_list_json *node);
-struct json *linked_list_json_get(struct linked_list_json *list, int index);
-
-// JSON linked list iterator API
-struct linked_list_json_iter *linked_list_json_iter_new(struct linked_list_json *list);
-void linked_list_json_iter_free(struct linked_list_json_iter *iter);
-struct json *linked_list_json_iter_next(struct linked_list_json_iter *iter);
-int linked_list_json_iter_has_next(struct linked_list_json_iter *iter);
+
+// ===== SLAB ALLOCATOR API =====
+void *slab_alloc(size_t size);
+void slab_free(void *ptr, size_t size);
+
+// ===== ARENA API =====
+void *json_arena_alloc(struct json_arena *arena, size_t size);
+void *json_arena_realloc(struct json_arena *arena, void *ptr, size_t old_size, size_t size);
+char *json_arena_strndup(struct json_arena *arena, const char *text, size_t length);
+
+// ===== JSON VECTOR API =====
+struct vector_json *vector_json_new(struct json_arena *arena);
+struct json_arena *vector_json_arena(const struct vector_json *vector);
+int vector_json_length(const struct vector_json *vector);
+void vector_json_free(struct vector_json *vector);
+struct vector_json *vector_json_share(struct vector_json *vector);
+int vector_json_release(struct vector_json *vector);
+int vector_json_shared(const struct vector_json *vector);
+int vector_json_deep(const struct vector_json *vector);
+struct vector_json *vector_json_clone(const struct vector_json *vector, int (*copy_value)(json_cell, json_cell *), void (*free_value)(json_cell));
+int vector_json_reserve(struct vector_json *vector, int capacity);
+int vector_json_push(struct vector_json *vector, json_cell value);
+json_cell *vector_json_get(const struct vector_json *vector, int index);
+
+// ===== STRING BUFFER API =====
+void string_buffer_init(struct string_buffer *buffer);
+int string_buffer_push(struct string_buffer *buffer, char c);
+int string_buffer_append(struct string_buffer *buffer, const char *data, size_t length);
+char *string_buffer_take(struct string_buffer *buffer);
+void string_buffer_free(struct string_buffer *buffer);
 
 // ===== HASH TABLE API =====
+uint64_t hash_table_hash(const char *key, size_t length);
 const char *hash_table_entry_key(const struct hash_table_entry *entry);
-void *hash_table_entry_value(const struct hash_table_entry *entry);
-struct hash_table *hash_table_new();
-void hash_table_free(struct hash_table *table, free_func free_value);
-void hash_table_set(struct hash_table *table, const char *key, void *value);
-void *hash_table_get(const struct hash_table *table, const char *key);
-void *hash_table_remove(struct hash_table *table, const char *key);
+size_t hash_table_entry_key_length(const struct hash_table_entry *entry);
+json_cell *hash_table_entry_value(const struct hash_table_entry *entry);
+struct hash_table *hash_table_new(struct json_arena *arena);
+struct json_arena *hash_table_arena(const struct hash_table *table);
+void hash_table_free(struct hash_table *table, void (*free_value)(json_cell));
+struct hash_table *hash_table_share(struct hash_table *table);
+int hash_table_release(struct hash_table *table);
+int hash_table_shared(const struct hash_table *table);
+int hash_table_deep(const struct hash_table *table);
+struct hash_table *hash_table_clone(const struct hash_table *table, int (*copy_value)(json_cell, json_cell *), void (*free_value)(json_cell));
+int hash_table_set(struct hash_table *table, const char *key, json_cell value);
+json_cell *hash_table_get(const struct hash_table *table, const char *key);
+int hash_table_remove(struct hash_table *table, const char *key, json_cell *value);
+int hash_table_set_n(struct hash_table *table, const char *key, size_t length, json_cell value);
+json_cell *hash_table_get_n(const struct hash_table *table, const char *key, size_t length);
+int hash_table_set_hashed(struct hash_table *table, const char *key, size_t length, uint64_t hash, json_cell value);
+json_cell *hash_table_get_hashed(const struct hash_table *table, const char *key, size_t length, uint64_t hash);
+int hash_table_remove_n(struct hash_table *table, const char *key, size_t length, json_cell *value);
 int hash_table_has(const struct hash_table *table, const char *key);
 int hash_table_keys(const struct hash_table *table, char **keys);
-void hash_table_foreach(const struct hash_table *table, struct closure *closure);
-
-// Hash table iterator API
-struct hash_table_iter *hash_table_iter_new(const struct hash_table *table);
-void hash_table_iter_free(struct hash_table_iter *iter);
-struct hash_table_entry *hash_table_iter_next(struct hash_table_iter *iter);
-int hash_table_iter_has_next(struct hash_table_iter *iter);
+struct hash_table_entry *hash_table_next(const struct hash_table *table, size_t *position);
 
 /**
  * JSON value types
@@ -110,22 +172,92 @@ typedef enum json_type
     JSON_OBJECT
 } json_type;
 
+// Node allocated from an arena, along with everything it holds
+#define JSON_NODE_ARENA 0x01
+// Node of a document, which edits modify in place
+#define JSON_NODE_DOCUMENT 0x02
+
+// Strings shorter than this are stored in the node, with their NUL terminator
+#define LIBJSON_INLINE_STRING_SIZE 16
+
 /**
  * JSON structure implementation
  */
 struct json
 {
-    json_type type;
+    // json_type of the value
+    unsigned char type;
+    // Length of a string stored in the node plus one, 0 otherwise
+    unsigned char inline_size;
+    // JSON_NODE_* flags
+    unsigned char flags;
+    // Owners of a shared scalar, always 1 for containers, whose storage is
+    // shared instead
+    unsigned refs;
     union
     {
-        int boolean;
-        double number;
-        char *string;
-        struct linked_list_json *array;
-        struct hash_table *object;
-    } value;
+        struct
+        {
+            union
+            {
+                int boolean;
+                double number;
+                char *string;
+                struct vector_json *array;
+                struct hash_table *object;
+            } value;
+            // Literal source text kept by lazy parsing (NULL otherwise)
+            char *raw;
+        };
+        // Short strings, in place of the value and the raw text
+        char inline_string[LIBJSON_INLINE_STRING_SIZE];
+    };
 };
 
+// Static JSON singleton values (externally defined)
+extern struct json json_null_value;
+extern struct json json_true_value;
+extern struct json json_false_value;
+
+// Static null, true and false values, which are never allocated nor freed
+static inline int json_is_singleton(const struct json *node)
+{
+    return node == &json_null_value || node == &json_true_value || node == &json_false_value;
+}
+
+// Decoded text of a string node, or NULL while a lazy string is not decoded
+static inline char *json_string_data(const struct json *node)
+{
+    return node->inline_size ? (char *)node->inline_string : node->value.string;
+}
+
+// Raw source text of a node, which strings stored in the node never have
+static inline char *json_raw(const struct json *node)
+{
+    return node->inline_size ? NULL : node->raw;
+}
+
+// Nodes that can be shared by copies instead of copied: nodes of an arena or
+// of a document must not be, and neither must lazy strings, which are
+// modified when they are decoded
+static inline int json_is_shareable(const struct json *json)
+{
+    if (json->flags & (JSON_NODE_ARENA | JSON_NODE_DOCUMENT))
+        return 0;
+    return json->type != JSON_STRING || json_string_data(json);
+}
+
+// Cells that arrays and objects shared by copies may hold: numbers and
+// shareable scalars. Arrays and objects are not, since the getters hand them
+// out to be modified.
+static inline int json_cell_shareable(json_cell cell)
+{
+    if (!json_cell_is_node(cell))
+        return 1;
+    const struct json *node = json_cell_node(cell);
+    return !node || (node->type != JSON_ARRAY && node->type != JSON_OBJECT && json_is_shareable(node));
+}
+
 /**
  * JSON token types for parsing
  */
@@ -149,6 +281,35 @@ struct json_token
     } type;
     // only used for JSON_TOKEN_STRING and JSON_TOKEN_NUMBER
     char *value;
+    // only used for JSON_TOKEN_STRING: value still holds escape sequences
+    int escaped;
+    // stream offset of the first character of the token
+    long long start;
+};
+
+/**
+ * Source span of a parsed value, kept in a tree beside the values so that
+ * edited text can be re-parsed locally
+ */
+struct json_span
+{
+    struct json *node;
+    long long start;  // relative to the start of the parent span
+    long long length; // up to and including the last character of the value
+    struct json_span *parent;
+    struct json_span **children; // in source order
+    size_t count;
+    size_t capacity;
+};
+
+/**
+ * Records the spans of the values parsed with an error context
+ */
+struct json_span_builder
+{
+    struct json_span *root;
+    struct json_span *current;
+    int failed;
 };
 
 /**
@@ -159,30 +320,71 @@ struct error_context
     char *message;
     int line;
     int column;
+    long long offset; // bytes consumed from the stream
+    const struct json_read_options *options;
+    struct json_span_builder *spans; // NULL unless spans are recorded
+    int out_of_memory;               // set when parsing failed to allocate
 };
 
-// Static JSON singleton values (externally defined)
-extern struct json json_null_value;
-extern struct json json_true_value;
-extern struct json json_false_value;
+// Arena that parsed values are allocated from, NULL for the heap
+static inline struct json_arena *json_context_arena(const struct error_context *errctx)
+{
+    return errctx && errctx->options ? errctx->options->arena : NULL;
+}
 
 // Default error buffer (externally defined)
 extern char __default_errbuf[LIBJSON_ERRBUF_SiZE];
 
+// RFC 7464 record separator that starts each JSON text sequence element
+#define LIBJSON_RECORD_SEPARATOR 0x1E
+
+// Maximum number of characters of an invalid token echoed in the error message
+#define LIBJSON_TOKEN_ECHO_MAX 256
+
+// Internal JSON creation functions, allocating from the arena unless it is NULL
+struct json *json_node_new(struct json_arena *arena, json_type type);
+void json_node_free(struct json *node);
+struct json *json_number_new(struct json_arena *arena, double value);
+struct json *json_number_literal(struct json_arena *arena, char *text);
+struct json *json_string_new(struct json_arena *arena, const char *value);
+struct json *json_string_take(struct json_arena *arena, char *value, char *raw);
+struct json *json_array_new(struct json_arena *arena);
+struct json *json_object_new(struct json_arena *arena);
+void json_free_value(struct json *json);
+int json_unshare(struct json *container);
+
+// Cell functions
+struct json *json_cell_box(json_cell *cell, struct json_arena *arena);
+void json_cell_free(json_cell cell);
+int json_cell_copy(json_cell cell, json_cell *copy);
+int json_array_push_cell(struct json *array, json_cell cell);
+
 // Internal helper functions
 void strprep(char *dst, const char *src);
-int update_error_context(struct error_context *errctx, const char c, int index);
+int update_error_context(struct error_context *errctx, int c, int index);
+int json_ungetc(int c, FILE *in, struct error_context *errctx);
+int json_number_literal_valid(const char *text);
+char *json_unescape(const char *raw, size_t *length);
+int utf8_encode(unsigned long codepoint, char *out);
+
+// Source span functions, no-ops when the context does not record spans
+struct json_span *json_span_open(struct error_context *errctx, const struct json_token *token);
+void json_span_close(struct error_context *errctx, struct json_span *span, struct json *node);
+void json_span_free(struct json_span *span);
 
 // JSON write helper functions
 int json_write_escaped_string(const char *str, FILE *out);
+int json_write_escaped_bytes(const char *str, size_t length, FILE *out);
 int json_write_array(struct json *array, FILE *out);
 int json_write_object(struct json *object, FILE *out);
 int json_write_string(struct json *node, FILE *out);
 int json_write_number(struct json *node, FILE *out);
 int json_write_boolean(struct json *node, FILE *out);
 int json_write_null(struct json *node, FILE *out);
+int json_write_cell(json_cell cell, FILE *out);
 
 // JSON read helper functions
+struct json *json_read_value(FILE *in, struct error_context *errctx);
 struct json_token json_read_token(FILE *in, struct error_context *errctx);
 int json_parser_json(FILE *in, struct json_token *token, struct json **dest, struct error_context *errctx);
 int json_parser_literal(FILE *in, struct json_token *token, struct json **dest, struct error_context *errctx);
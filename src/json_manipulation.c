@@ -8,26 +8,54 @@
  * @subsection JSON array manipulation functions
  */
 
-void json_array_push(struct json *array, struct json *value)
+// Reads the number of a cell without boxing it, so that readers of numbers
+// never allocate. Returns 0 if the cell holds another value.
+static int json_cell_get_number(const json_cell *cell, double *value)
 {
-    if (!array || !value || !json_is_array(array))
-        return;
-
-    if (!array->value.array)
+    if (!cell)
+        return 0;
+    json_cell current = json_cell_load(cell);
+    if (json_cell_is_node(current))
     {
-        // Create the first node
-        array->value.array = linked_list_json_new(value);
+        const struct json *node = json_cell_node(current);
+        if (!node || node->type != JSON_NUMBER)
+            return 0;
+        if (value)
+            *value = json_double_value(node);
+        return 1;
     }
-    else
+    if (value)
+        *value = json_cell_number(current);
+    return 1;
+}
+
+int json_array_push_cell(struct json *array, json_cell cell)
+{
+    if (!json_unshare(array))
+        return 0;
+    if (!array->value.array)
     {
-        // Find the last node and insert after it
-        struct linked_list_json *node = array->value.array;
-        while (linked_list_json_next(node))
-        {
-            node = linked_list_json_next(node);
-        }
-        linked_list_json_insert(node, value);
+        array->value.array = vector_json_new(NULL);
+        if (!array->value.array)
+            return 0;
     }
+    return vector_json_push(array->value.array, cell);
+}
+
+void json_array_push(struct json *array, struct json *value)
+{
+    if (!array || !value || !json_is_array(array))
+        return;
+
+    json_array_push_cell(array, json_cell_from_node(value));
+}
+
+void json_array_push_number(struct json *array, double value)
+{
+    if (!array || !json_is_array(array))
+        return;
+
+    json_array_push_cell(array, json_cell_from_number(value));
 }
 
 int json_array_length(struct json *array)
@@ -35,7 +63,7 @@ int json_array_length(struct json *array)
     if (!array || !json_is_array(array))
         return 0;
 
-    return linked_list_json_length(array->value.array);
+    return vector_json_length(array->value.array);
 }
 
 struct json *json_array_get(const struct json *array, int index)
@@ -43,7 +71,16 @@ struct json *json_array_get(const struct json *array, int index)
     if (!array || !json_is_array((struct json *)array) || index < 0)
         return NULL;
 
-    return linked_list_json_get(array->value.array, index);
+    json_cell *cell = vector_json_get(array->value.array, index);
+    return cell ? json_cell_box(cell, vector_json_arena(array->value.array)) : NULL;
+}
+
+int json_array_get_number(const struct json *array, int index, double *value)
+{
+    if (!array || !json_is_array((struct json *)array) || index < 0)
+        return 0;
+
+    return json_cell_get_number(vector_json_get(array->value.array, index), value);
 }
 
 /**
@@ -54,8 +91,30 @@ void json_object_set(struct json *object, const char *key, struct json *value)
 {
     if (!object || !key || !value || !json_is_object(object))
         return;
+    if (!json_unshare(object))
+        return;
+
+    hash_table_set(object->value.object, key, json_cell_from_node(value));
+}
+
+void json_object_set_n(struct json *object, const char *key, size_t length, struct json *value)
+{
+    if (!object || !key || !value || !json_is_object(object))
+        return;
+    if (!json_unshare(object))
+        return;
+
+    hash_table_set_n(object->value.object, key, length, json_cell_from_node(value));
+}
+
+void json_object_set_number(struct json *object, const char *key, double value)
+{
+    if (!object || !key || !json_is_object(object))
+        return;
+    if (!json_unshare(object))
+        return;
 
-    hash_table_set(object->value.object, key, value);
+    hash_table_set(object->value.object, key, json_cell_from_number(value));
 }
 
 struct json *json_object_get(const struct json *object, const char *key)
@@ -63,7 +122,65 @@ struct json *json_object_get(const struct json *object, const char *key)
     if (!object || !key || !json_is_object((struct json *)object))
         return NULL;
 
-    return (struct json *)hash_table_get(object->value.object, key);
+    json_cell *cell = hash_table_get(object->value.object, key);
+    return cell ? json_cell_box(cell, hash_table_arena(object->value.object)) : NULL;
+}
+
+int json_object_get_number(const struct json *object, const char *key, double *value)
+{
+    if (!object || !key || !json_is_object((struct json *)object))
+        return 0;
+
+    return json_cell_get_number(hash_table_get(object->value.object, key), value);
+}
+
+struct json *json_object_get_n(const struct json *object, const char *key, size_t length)
+{
+    if (!object || !key || !json_is_object((struct json *)object))
+        return NULL;
+
+    json_cell *cell = hash_table_get_n(object->value.object, key, length);
+    return cell ? json_cell_box(cell, hash_table_arena(object->value.object)) : NULL;
+}
+
+struct json_key json_key_make(const char *key)
+{
+    return json_key_make_n(key, key ? strlen(key) : 0);
+}
+
+struct json_key json_key_make_n(const char *key, size_t length)
+{
+    struct json_key made = {.key = key, .length = length, .hash = 0};
+    if (key)
+        made.hash = hash_table_hash(key, length);
+    return made;
+}
+
+struct json *json_object_get_key(const struct json *object, const struct json_key *key)
+{
+    if (!object || !key || !key->key || !json_is_object((struct json *)object))
+        return NULL;
+
+    json_cell *cell = hash_table_get_hashed(object->value.object, key->key, key->length, key->hash);
+    return cell ? json_cell_box(cell, hash_table_arena(object->value.object)) : NULL;
+}
+
+int json_object_get_key_number(const struct json *object, const struct json_key *key, double *value)
+{
+    if (!object || !key || !key->key || !json_is_object((struct json *)object))
+        return 0;
+
+    return json_cell_get_number(hash_table_get_hashed(object->value.object, key->key, key->length, key->hash), value);
+}
+
+void json_object_set_key(struct json *object, const struct json_key *key, struct json *value)
+{
+    if (!object || !key || !key->key || !value || !json_is_object(object))
+        return;
+    if (!json_unshare(object))
+        return;
+
+    hash_table_set_hashed(object->value.object, key->key, key->length, key->hash, json_cell_from_node(value));
 }
 
 int json_object_length(struct json *object)
@@ -79,5 +196,77 @@ struct json *json_object_remove(struct json *object, const char *key)
     if (!object || !key || !json_is_object(object))
         return NULL;
 
-    return (struct json *)hash_table_remove(object->value.object, key);
+    return json_object_remove_n(object, key, strlen(key));
+}
+
+struct json *json_object_remove_n(struct json *object, const char *key, size_t length)
+{
+    if (!object || !key || !json_is_object(object))
+        return NULL;
+    if (!json_unshare(object))
+        return NULL;
+
+    // Boxed first, so that an inline number is handed over as a node
+    json_cell *cell = hash_table_get_n(object->value.object, key, length);
+    if (!cell || !json_cell_box(cell, hash_table_arena(object->value.object)))
+        return NULL;
+    json_cell value;
+    if (!hash_table_remove_n(object->value.object, key, length, &value))
+        return NULL;
+    return json_cell_node(value);
+}
+
+/**
+ * @subsection JSON iteration functions
+ */
+
+void json_array_iter_init(struct json_array_iter *iter, const struct json *array)
+{
+    if (!iter)
+        return;
+    iter->value = NULL;
+    iter->index = -1;
+    iter->array = NULL;
+    if (array && json_is_array((struct json *)array))
+        iter->array = array;
+}
+
+int json_array_iter_next(struct json_array_iter *iter)
+{
+    if (!iter || !iter->array)
+        return 0;
+
+    json_cell *cell = vector_json_get(iter->array->value.array, iter->index + 1);
+    iter->value = cell ? json_cell_box(cell, vector_json_arena(iter->array->value.array)) : NULL;
+    if (!iter->value)
+        return 0;
+    iter->index++;
+    return 1;
+}
+
+void json_object_iter_init(struct json_object_iter *iter, const struct json *object)
+{
+    if (!iter)
+        return;
+    iter->key = NULL;
+    iter->key_length = 0;
+    iter->value = NULL;
+    iter->object = NULL;
+    iter->position = 0;
+    if (object && json_is_object((struct json *)object))
+        iter->object = object;
+}
+
+int json_object_iter_next(struct json_object_iter *iter)
+{
+    if (!iter || !iter->object)
+        return 0;
+
+    struct hash_table_entry *entry = hash_table_next(iter->object->value.object, &iter->position);
+    iter->value = entry ? json_cell_box(hash_table_entry_value(entry), hash_table_arena(iter->object->value.object)) : NULL;
+    if (!iter->value)
+        return 0;
+    iter->key = hash_table_entry_key(entry);
+    iter->key_length = hash_table_entry_key_length(entry);
+    return 1;
 }
@@ -0,0 +1,81 @@
+#include "json_internal.h"
+
+/**
+ * @section Memory allocation functions
+ */
+
+static void *json_default_malloc(size_t size, void *ctx)
+{
+    (void)ctx;
+    return malloc(size);
+}
+
+static void *json_default_realloc(void *ptr, size_t size, void *ctx)
+{
+    (void)ctx;
+    return realloc(ptr, size);
+}
+
+static void json_default_free(void *ptr, void *ctx)
+{
+    (void)ctx;
+    free(ptr);
+}
+
+static struct
+{
+    json_malloc_func malloc_fn;
+    json_realloc_func realloc_fn;
+    json_free_func free_fn;
+    void *ctx;
+} json_allocator = {json_default_malloc, json_default_realloc, json_default_free, NULL};
+
+void json_set_allocator(json_malloc_func malloc_fn, json_realloc_func realloc_fn, json_free_func free_fn, void *ctx)
+{
+    if (!malloc_fn || !realloc_fn || !free_fn)
+    {
+        malloc_fn = json_default_malloc;
+        realloc_fn = json_default_realloc;
+        free_fn = json_default_free;
+        ctx = NULL;
+    }
+    json_allocator.malloc_fn = malloc_fn;
+    json_allocator.realloc_fn = realloc_fn;
+    json_allocator.free_fn = free_fn;
+    json_allocator.ctx = ctx;
+}
+
+void *json_mem_alloc(size_t size)
+{
+    return json_allocator.malloc_fn(size, json_allocator.ctx);
+}
+
+void *json_mem_calloc(size_t count, size_t size)
+{
+    if (size && count > (size_t)-1 / size)
+        return NULL;
+    void *ptr = json_mem_alloc(count * size);
+    if (ptr)
+        memset(ptr, 0, count * size);
+    return ptr;
+}
+
+void *json_mem_realloc(void *ptr, size_t size)
+{
+    return json_allocator.realloc_fn(ptr, size, json_allocator.ctx);
+}
+
+void json_mem_free(void *ptr)
+{
+    if (ptr)
+        json_allocator.free_fn(ptr, json_allocator.ctx);
+}
+
+char *json_mem_strdup(const char *text)
+{
+    size_t length = strlen(text);
+    char *copy = json_mem_alloc(length + 1);
+    if (copy)
+        memcpy(copy, text, length + 1);
+    return copy;
+}
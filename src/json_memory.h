@@ -0,0 +1,16 @@
+#ifndef LIBJSON_JSON_MEMORY_H
+#define LIBJSON_JSON_MEMORY_H
+
+#include <stddef.h>
+
+// Every allocation of the library goes through these functions, which call
+// the allocator set with json_set_allocator(). Kept apart from json_internal.h
+// so that sources including third-party headers can use them.
+
+void *json_mem_alloc(size_t size);
+void *json_mem_calloc(size_t count, size_t size);
+void *json_mem_realloc(void *ptr, size_t size);
+void json_mem_free(void *ptr);
+char *json_mem_strdup(const char *text);
+
+#endif // LIBJSON_JSON_MEMORY_H
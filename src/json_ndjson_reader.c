@@ -0,0 +1,142 @@
+#include "json_internal.h"
+
+#include <errno.h>
+#include <sys/types.h>
+
+/**
+ * @section Newline-delimited JSON reading functions
+ */
+
+struct json_ndjson_reader
+{
+    FILE *in;
+    struct json_read_options options;
+    json_ndjson_error_func on_error;
+    void *ctx;
+    struct json_ndjson_stats stats;
+    // Line buffer reused across records
+    char *line;
+    size_t line_capacity;
+    char errbuf[LIBJSON_ERRBUF_SiZE];
+    // Reason reading stopped before the end of the stream, empty otherwise
+    char read_error[LIBJSON_ERRBUF_SiZE];
+};
+
+struct json_ndjson_reader *json_ndjson_reader_new(FILE *in, const struct json_read_options *options, json_ndjson_error_func on_error, void *ctx)
+{
+    if (!in)
+        return NULL;
+    struct json_ndjson_reader *reader = json_mem_alloc(sizeof(struct json_ndjson_reader));
+    if (!reader)
+        return NULL;
+
+    memset(reader, 0, sizeof(struct json_ndjson_reader));
+    reader->in = in;
+    if (options)
+        reader->options = *options;
+    reader->on_error = on_error;
+    reader->ctx = ctx;
+    return reader;
+}
+
+void json_ndjson_reader_free(struct json_ndjson_reader *reader)
+{
+    if (!reader)
+        return;
+    // Allocated by getline() with the C library
+    free(reader->line);
+    json_mem_free(reader);
+}
+
+const struct json_ndjson_stats *json_ndjson_reader_stats(const struct json_ndjson_reader *reader)
+{
+    return reader ? &reader->stats : NULL;
+}
+
+static void json_ndjson_reader_fail(struct json_ndjson_reader *reader, long long offset, enum json_ndjson_failure reason)
+{
+    reader->stats.failures++;
+    reader->stats.failure_reasons[reason]++;
+    if (reader->on_error)
+        reader->on_error(offset, reader->stats.lines, reason, reader->errbuf, reader->ctx);
+}
+
+// Parses a single line. Returns NULL with the failure reason set on error.
+static struct json *json_ndjson_parse_line(struct json_ndjson_reader *reader, const char *line, size_t length, enum json_ndjson_failure *reason)
+{
+    FILE *memfile = fmemopen((void *)line, length, "r");
+    if (!memfile)
+    {
+        strcpy(reader->errbuf, "Out of memory.");
+        *reason = JSON_NDJSON_OUT_OF_MEMORY;
+        return NULL;
+    }
+    struct error_context errctx = {
+        .message = reader->errbuf,
+        .line = 0,
+        .column = 0,
+        .offset = 0,
+        .options = &reader->options};
+    struct json *result = json_read_value(memfile, &errctx);
+    fclose(memfile);
+    if (!result)
+    {
+        *reason = errctx.out_of_memory ? JSON_NDJSON_OUT_OF_MEMORY : JSON_NDJSON_SYNTAX;
+        return NULL;
+    }
+
+    // Nothing but whitespace may follow the record
+    for (size_t i = errctx.offset; i < length; i++)
+    {
+        if (!isspace((unsigned char)line[i]))
+        {
+            sprintf(reader->errbuf, "Error parsing JSON (1:%lld): Unexpected data after value.", errctx.offset + 1);
+            json_free(result);
+            *reason = JSON_NDJSON_TRAILING_DATA;
+            return NULL;
+        }
+    }
+    return result;
+}
+
+struct json *json_ndjson_reader_next(struct json_ndjson_reader *reader)
+{
+    if (!reader)
+        return NULL;
+
+    ssize_t length;
+    errno = 0;
+    while ((length = getline(&reader->line, &reader->line_capacity, reader->in)) >= 0)
+    {
+        long long offset = reader->stats.bytes;
+        reader->stats.bytes += length;
+        reader->stats.lines++;
+
+        // Blank lines are not records
+        ssize_t i = 0;
+        while (i < length && isspace((unsigned char)reader->line[i]))
+            i++;
+        if (i == length)
+            continue;
+
+        enum json_ndjson_failure reason;
+        struct json *result = json_ndjson_parse_line(reader, reader->line, length, &reason);
+        if (result)
+        {
+            reader->stats.records++;
+            return result;
+        }
+        json_ndjson_reader_fail(reader, offset, reason);
+        errno = 0;
+    }
+    // getline() also returns -1 when the stream fails or a line does not fit
+    // in memory
+    if (ferror(reader->in) || errno == ENOMEM)
+        sprintf(reader->read_error, "Error reading JSON: %s", strerror(errno ? errno : EIO));
+    return NULL;
+}
+
+const char *json_ndjson_reader_error(const struct json_ndjson_reader *reader)
+{
+    return reader && reader->read_error[0] ? reader->read_error : NULL;
+}
@@ -0,0 +1,1096 @@
+#include "json_internal.h"
+#include "libjson/json_persistent.h"
+
+/**
+ * @section Persistent value functions
+ */
+
+// Arrays and objects are tries indexed by 5 bits of the index or of the hash
+// at each level
+#define LIBJSON_PERSISTENT_BITS 5
+#define LIBJSON_PERSISTENT_WIDTH (1 << LIBJSON_PERSISTENT_BITS)
+#define LIBJSON_PERSISTENT_MASK (LIBJSON_PERSISTENT_WIDTH - 1)
+#define LIBJSON_PERSISTENT_HASH_BITS 64
+
+/**
+ * Chunk of an array: up to 32 values at the leaves, or the chunks of the
+ * level below. Unused slots are NULL.
+ */
+struct persistent_chunk
+{
+    unsigned refs;
+    void *slots[LIBJSON_PERSISTENT_WIDTH];
+};
+
+/**
+ * Key of an object, shared by every version that has it
+ */
+struct persistent_key
+{
+    unsigned refs;
+    uint64_t hash;
+    size_t length;
+    char text[]; // NUL-terminated past its length
+};
+
+struct persistent_entry
+{
+    struct persistent_key *key;
+    uint64_t order; // keys are listed by increasing order
+    struct json_persistent *value;
+};
+
+/**
+ * Node of the trie of an object. An entry is stored in the node when no other
+ * entry of the node has the same 5 bits of hash at its depth, and in the
+ * child for these bits otherwise. Nodes past the bits of the hash only hold
+ * entries whose hashes collide, as a list.
+ */
+struct persistent_node
+{
+    unsigned refs;
+    uint32_t datamap; // bits of the hash of the entries
+    uint32_t nodemap; // bits of the hash of the children
+    unsigned entry_count;
+    unsigned child_count;
+    struct persistent_entry *entries; // by increasing bits, after the node
+    struct persistent_node **children;
+};
+
+struct json_persistent
+{
+    unsigned refs;
+    unsigned char type; // json_type of the value
+    union
+    {
+        struct json *scalar;
+        struct
+        {
+            struct persistent_chunk *root; // full leaves, NULL while there are none
+            struct persistent_chunk *tail; // last elements, NULL while empty
+            int length;
+            int shift; // bits of the index below the level of root
+        } array;
+        struct
+        {
+            struct persistent_node *root; // NULL while empty
+            int size;
+            uint64_t next_order;
+        } object;
+    };
+};
+
+static struct json_persistent *json_persistent_new(json_type type)
+{
+    struct json_persistent *value = slab_alloc(sizeof(struct json_persistent));
+    if (!value)
+        return NULL;
+    memset(value, 0, sizeof(struct json_persistent));
+    value->refs = 1;
+    value->type = type;
+    if (type == JSON_ARRAY)
+        value->array.shift = LIBJSON_PERSISTENT_BITS;
+    return value;
+}
+
+static struct json_persistent *json_persistent_retain(const struct json_persistent *value)
+{
+    json_refs_retain(&((struct json_persistent *)value)->refs);
+    return (struct json_persistent *)value;
+}
+
+/**
+ * @subsection Array chunk functions
+ */
+
+static struct persistent_chunk *persistent_chunk_new(void)
+{
+    struct persistent_chunk *chunk = json_mem_calloc(1, sizeof(struct persistent_chunk));
+    if (chunk)
+        chunk->refs = 1;
+    return chunk;
+}
+
+// Releases a chunk at a level, 0 being the leaves, and what it holds with it
+static void persistent_chunk_release(struct persistent_chunk *chunk, int level)
+{
+    if (!chunk || !json_refs_release(&chunk->refs))
+        return;
+    for (int i = 0; i < LIBJSON_PERSISTENT_WIDTH && chunk->slots[i]; i++)
+    {
+        if (level)
+            persistent_chunk_release(chunk->slots[i], level - LIBJSON_PERSISTENT_BITS);
+        else
+            json_persistent_free(chunk->slots[i]);
+    }
+    json_mem_free(chunk);
+}
+
+// Copies a chunk, sharing what it holds
+static struct persistent_chunk *persistent_chunk_clone(const struct persistent_chunk *chunk, int level)
+{
+    struct persistent_chunk *clone = persistent_chunk_new();
+    if (!clone || !chunk)
+        return clone;
+    for (int i = 0; i < LIBJSON_PERSISTENT_WIDTH && chunk->slots[i]; i++)
+    {
+        clone->slots[i] = chunk->slots[i];
+        if (level)
+            json_refs_retain(&((struct persistent_chunk *)chunk->slots[i])->refs);
+        else
+            json_persistent_retain(chunk->slots[i]);
+    }
+    return clone;
+}
+
+// Replaces a slot of a clone, releasing the shared value it held
+static void persistent_chunk_replace(struct persistent_chunk *chunk, int index, void *slot, int level)
+{
+    if (level)
+        persistent_chunk_release(chunk->slots[index], level - LIBJSON_PERSISTENT_BITS);
+    else
+        json_persistent_free(chunk->slots[index]);
+    chunk->slots[index] = slot;
+}
+
+// Index of the first element of the tail
+static int persistent_array_tail_offset(const struct json_persistent *array)
+{
+    if (array->array.length < LIBJSON_PERSISTENT_WIDTH)
+        return 0;
+    return ((array->array.length - 1) >> LIBJSON_PERSISTENT_BITS) << LIBJSON_PERSISTENT_BITS;
+}
+
+// Leaf holding the element at an index
+static struct persistent_chunk *persistent_array_leaf(const struct json_persistent *array, int index)
+{
+    if (index >= persistent_array_tail_offset(array))
+        return array->array.tail;
+    struct persistent_chunk *chunk = array->array.root;
+    for (int level = array->array.shift; level > 0; level -= LIBJSON_PERSISTENT_BITS)
+        chunk = chunk->slots[(index >> level) & LIBJSON_PERSISTENT_MASK];
+    return chunk;
+}
+
+// Chunks from a level down to a leaf
+static struct persistent_chunk *persistent_chunk_path(int level, struct persistent_chunk *leaf)
+{
+    if (!level)
+    {
+        json_refs_retain(&leaf->refs);
+        return leaf;
+    }
+    struct persistent_chunk *chunk = persistent_chunk_new();
+    if (!chunk)
+        return NULL;
+    chunk->slots[0] = persistent_chunk_path(level - LIBJSON_PERSISTENT_BITS, leaf);
+    if (!chunk->slots[0])
+    {
+        json_mem_free(chunk);
+        return NULL;
+    }
+    return chunk;
+}
+
+// Copies the path to the last leaf of a tree of length elements, adding the
+// leaf after it
+static struct persistent_chunk *persistent_chunk_push_leaf(const struct persistent_chunk *chunk, int level, int length, struct persistent_chunk *leaf)
+{
+    int index = ((length - 1) >> level) & LIBJSON_PERSISTENT_MASK;
+    struct persistent_chunk *clone = persistent_chunk_clone(chunk, level);
+    if (!clone)
+        return NULL;
+
+    struct persistent_chunk *child;
+    if (level == LIBJSON_PERSISTENT_BITS)
+        child = persistent_chunk_path(0, leaf);
+    else if (chunk && chunk->slots[index])
+        child = persistent_chunk_push_leaf(chunk->slots[index], level - LIBJSON_PERSISTENT_BITS, length, leaf);
+    else
+        child = persistent_chunk_path(level - LIBJSON_PERSISTENT_BITS, leaf);
+    if (!child)
+    {
+        persistent_chunk_release(clone, level);
+        return NULL;
+    }
+    persistent_chunk_replace(clone, index, child, level);
+    return clone;
+}
+
+// Copies the path to the element at an index, replacing it
+static struct persistent_chunk *persistent_chunk_set(const struct persistent_chunk *chunk, int level, int index, struct json_persistent *value)
+{
+    struct persistent_chunk *clone = persistent_chunk_clone(chunk, level);
+    if (!clone)
+        return NULL;
+
+    int slot = (index >> level) & LIBJSON_PERSISTENT_MASK;
+    void *child = value;
+    if (level)
+    {
+        child = persistent_chunk_set(chunk->slots[slot], level - LIBJSON_PERSISTENT_BITS, index, value);
+        if (!child)
+        {
+            persistent_chunk_release(clone, level);
+            return NULL;
+        }
+    }
+    persistent_chunk_replace(clone, slot, child, level);
+    return clone;
+}
+
+// Copies the path to the last leaf of a tree of length elements, without the
+// leaf. Sets *empty instead when no leaf is left.
+static struct persistent_chunk *persistent_chunk_pop_leaf(const struct persistent_chunk *chunk, int level, int length, int *empty)
+{
+    int index = ((length - 2) >> level) & LIBJSON_PERSISTENT_MASK;
+    void *child = NULL;
+    if (level > LIBJSON_PERSISTENT_BITS)
+    {
+        int child_empty = 0;
+        child = persistent_chunk_pop_leaf(chunk->slots[index], level - LIBJSON_PERSISTENT_BITS, length, &child_empty);
+        if (child_empty && index == 0)
+        {
+            *empty = 1;
+            return NULL;
+        }
+        if (!child && !child_empty)
+            return NULL;
+    }
+    else if (index == 0)
+    {
+        *empty = 1;
+        return NULL;
+    }
+
+    struct persistent_chunk *clone = persistent_chunk_clone(chunk, level);
+    if (!clone)
+    {
+        persistent_chunk_release(child, level - LIBJSON_PERSISTENT_BITS);
+        return NULL;
+    }
+    persistent_chunk_replace(clone, index, child, level);
+    return clone;
+}
+
+/**
+ * @subsection Object node functions
+ */
+
+static struct persistent_key *persistent_key_new(const char *text, size_t length)
+{
+    struct persistent_key *key = json_mem_alloc(sizeof(struct persistent_key) + length + 1);
+    if (!key)
+        return NULL;
+    key->refs = 1;
+    key->hash = hash_table_hash(text, length);
+    key->length = length;
+    memcpy(key->text, text, length);
+    key->text[length] = '\0';
+    return key;
+}
+
+static void persistent_entry_retain(const struct persistent_entry *entry)
+{
+    json_refs_retain(&entry->key->refs);
+    json_persistent_retain(entry->value);
+}
+
+static void persistent_entry_release(const struct persistent_entry *entry)
+{
+    if (json_refs_release(&entry->key->refs))
+        json_mem_free(entry->key);
+    json_persistent_free(entry->value);
+}
+
+static int persistent_key_equals(const struct persistent_key *key, const char *text, size_t length, uint64_t hash)
+{
+    return key->hash == hash && key->length == length && memcmp(key->text, text, length) == 0;
+}
+
+static uint32_t persistent_node_bit(uint64_t hash, int shift)
+{
+    return (uint32_t)1 << ((hash >> shift) & LIBJSON_PERSISTENT_MASK);
+}
+
+// Position of the entry or child of a bit among those of a map
+static unsigned persistent_node_index(uint32_t map, uint32_t bit)
+{
+    map &= bit - 1;
+#if defined(__GNUC__)
+    return (unsigned)__builtin_popcount(map);
+#else
+    unsigned count = 0;
+    for (; map; map &= map - 1)
+        count++;
+    return count;
+#endif
+}
+
+// Allocates a node with room for the given numbers of entries and children
+static struct persistent_node *persistent_node_new(unsigned entry_count, unsigned child_count)
+{
+    struct persistent_node *node = json_mem_alloc(sizeof(struct persistent_node) + entry_count * sizeof(struct persistent_entry) + child_count * sizeof(struct persistent_node *));
+    if (!node)
+        return NULL;
+    node->refs = 1;
+    node->datamap = 0;
+    node->nodemap = 0;
+    node->entry_count = 0;
+    node->child_count = 0;
+    node->entries = (struct persistent_entry *)(node + 1);
+    node->children = (struct persistent_node **)(node->entries + entry_count);
+    return node;
+}
+
+static void persistent_node_release(struct persistent_node *node)
+{
+    if (!node || !json_refs_release(&node->refs))
+        return;
+    for (unsigned i = 0; i < node->entry_count; i++)
+        persistent_entry_release(&node->entries[i]);
+    for (unsigned i = 0; i < node->child_count; i++)
+        persistent_node_release(node->children[i]);
+    json_mem_free(node);
+}
+
+// Copies a node with room for more entries or children, sharing what it holds
+static struct persistent_node *persistent_node_clone(const struct persistent_node *node, unsigned entry_count, unsigned child_count)
+{
+    struct persistent_node *clone = persistent_node_new(entry_count, child_count);
+    if (!clone)
+        return NULL;
+    clone->datamap = node->datamap;
+    clone->nodemap = node->nodemap;
+    clone->entry_count = node->entry_count;
+    clone->child_count = node->child_count;
+    memcpy(clone->entries, node->entries, node->entry_count * sizeof(struct persistent_entry));
+    memcpy(clone->children, node->children, node->child_count * sizeof(struct persistent_node *));
+    for (unsigned i = 0; i < node->entry_count; i++)
+        persistent_entry_retain(&node->entries[i]);
+    for (unsigned i = 0; i < node->child_count; i++)
+        json_refs_retain(&node->children[i]->refs);
+    return clone;
+}
+
+static void persistent_node_insert_entry(struct persistent_node *node, unsigned index, const struct persistent_entry *entry)
+{
+    memmove(&node->entries[index + 1], &node->entries[index], (node->entry_count - index) * sizeof(struct persistent_entry));
+    node->entries[index] = *entry;
+    node->entry_count++;
+}
+
+// Removes an entry from the node, handing its references over to the caller
+static void persistent_node_take_entry(struct persistent_node *node, unsigned index)
+{
+    memmove(&node->entries[index], &node->entries[index + 1], (node->entry_count - index - 1) * sizeof(struct persistent_entry));
+    node->entry_count--;
+}
+
+// Node holding two entries from a depth on, with their references
+static struct persistent_node *persistent_node_pair(int shift, const struct persistent_entry *a, const struct persistent_entry *b)
+{
+    if (shift >= LIBJSON_PERSISTENT_HASH_BITS)
+    {
+        struct persistent_node *node = persistent_node_new(2, 0);
+        if (!node)
+            return NULL;
+        node->entries[0] = *a;
+        node->entries[1] = *b;
+        node->entry_count = 2;
+        return node;
+    }
+
+    uint32_t bit_a = persistent_node_bit(a->key->hash, shift);
+    uint32_t bit_b = persistent_node_bit(b->key->hash, shift);
+    if (bit_a == bit_b)
+    {
+        struct persistent_node *node = persistent_node_new(0, 1);
+        if (!node)
+            return NULL;
+        node->children[0] = persistent_node_pair(shift + LIBJSON_PERSISTENT_BITS, a, b);
+        if (!node->children[0])
+        {
+            json_mem_free(node);
+            return NULL;
+        }
+        node->nodemap = bit_a;
+        node->child_count = 1;
+        return node;
+    }
+
+    struct persistent_node *node = persistent_node_new(2, 0);
+    if (!node)
+        return NULL;
+    node->entries[bit_a < bit_b ? 0 : 1] = *a;
+    node->entries[bit_a < bit_b ? 1 : 0] = *b;
+    node->datamap = bit_a | bit_b;
+    node->entry_count = 2;
+    return node;
+}
+
+static const struct persistent_entry *persistent_node_find(const struct persistent_node *node, const char *key, size_t length, uint64_t hash)
+{
+    for (int shift = 0; node; shift += LIBJSON_PERSISTENT_BITS)
+    {
+        if (shift >= LIBJSON_PERSISTENT_HASH_BITS)
+        {
+            for (unsigned i = 0; i < node->entry_count; i++)
+            {
+                if (persistent_key_equals(node->entries[i].key, key, length, hash))
+                    return &node->entries[i];
+            }
+            return NULL;
+        }
+        uint32_t bit = persistent_node_bit(hash, shift);
+        if (node->datamap & bit)
+        {
+            const struct persistent_entry *entry = &node->entries[persistent_node_index(node->datamap, bit)];
+            return persistent_key_equals(entry->key, key, length, hash) ? entry : NULL;
+        }
+        if (!(node->nodemap & bit))
+            return NULL;
+        node = node->children[persistent_node_index(node->nodemap, bit)];
+    }
+    return NULL;
+}
+
+// Copies the path to the place of the entry, and sets it there. A replaced
+// key keeps its order. The references of the entry are only taken over on
+// success, and *added is set if the key is new.
+static struct persistent_node *persistent_node_set(const struct persistent_node *node, int shift, struct persistent_entry *entry, int *added)
+{
+    const struct persistent_key *key = entry->key;
+    if (shift >= LIBJSON_PERSISTENT_HASH_BITS)
+    {
+        for (unsigned i = 0; i < node->entry_count; i++)
+        {
+            if (!persistent_key_equals(node->entries[i].key, key->text, key->length, key->hash))
+                continue;
+            struct persistent_node *clone = persistent_node_clone(node, node->entry_count, node->child_count);
+            if (!clone)
+                return NULL;
+            entry->order = node->entries[i].order;
+            persistent_entry_release(&clone->entries[i]);
+            clone->entries[i] = *entry;
+            return clone;
+        }
+        struct persistent_node *clone = persistent_node_clone(node, node->entry_count + 1, 0);
+        if (!clone)
+            return NULL;
+        persistent_node_insert_entry(clone, clone->entry_count, entry);
+        *added = 1;
+        return clone;
+    }
+
+    uint32_t bit = persistent_node_bit(key->hash, shift);
+    if (node->datamap & bit)
+    {
+        unsigned index = persistent_node_index(node->datamap, bit);
+        const struct persistent_entry *existing = &node->entries[index];
+        if (persistent_key_equals(existing->key, key->text, key->length, key->hash))
+        {
+            struct persistent_node *clone = persistent_node_clone(node, node->entry_count, node->child_count);
+            if (!clone)
+                return NULL;
+            entry->order = existing->order;
+            persistent_entry_release(&clone->entries[index]);
+            clone->entries[index] = *entry;
+            return clone;
+        }
+
+        // Both entries move down to a new child
+        struct persistent_node *clone = persistent_node_clone(node, node->entry_count, node->child_count + 1);
+        if (!clone)
+            return NULL;
+        struct persistent_node *child = persistent_node_pair(shift + LIBJSON_PERSISTENT_BITS, existing, entry);
+        if (!child)
+        {
+            persistent_node_release(clone);
+            return NULL;
+        }
+        // The reference to the existing entry taken by the clone goes to the child
+        persistent_node_take_entry(clone, index);
+        clone->datamap &= ~bit;
+        unsigned child_index = persistent_node_index(clone->nodemap, bit);
+        memmove(&clone->children[child_index + 1], &clone->children[child_index], (clone->child_count - child_index) * sizeof(struct persistent_node *));
+        clone->children[child_index] = child;
+        clone->child_count++;
+        clone->nodemap |= bit;
+        *added = 1;
+        return clone;
+    }
+
+    if (node->nodemap & bit)
+    {
+        unsigned child_index = persistent_node_index(node->nodemap, bit);
+        struct persistent_node *child = persistent_node_set(node->children[child_index], shift + LIBJSON_PERSISTENT_BITS, entry, added);
+        if (!child)
+            return NULL;
+        struct persistent_node *clone = persistent_node_clone(node, node->entry_count, node->child_count);
+        if (!clone)
+        {
+            // The child holds the references of the entry, which stay with the caller
+            persistent_entry_retain(entry);
+            persistent_node_release(child);
+            *added = 0;
+            return NULL;
+        }
+        persistent_node_release(clone->children[child_index]);
+        clone->children[child_index] = child;
+        return clone;
+    }
+
+    struct persistent_node *clone = persistent_node_clone(node, node->entry_count + 1, node->child_count);
+    if (!clone)
+        return NULL;
+    persistent_node_insert_entry(clone, persistent_node_index(node->datamap, bit), entry);
+    clone->datamap |= bit;
+    *added = 1;
+    return clone;
+}
+
+// Copies the path to the entry of the key, without it. Sets *found if the key
+// is present, and returns NULL otherwise or when out of memory.
+static struct persistent_node *persistent_node_remove(const struct persistent_node *node, int shift, const char *key, size_t length, uint64_t hash, int *found)
+{
+    if (shift >= LIBJSON_PERSISTENT_HASH_BITS)
+    {
+        for (unsigned i = 0; i < node->entry_count; i++)
+        {
+            if (!persistent_key_equals(node->entries[i].key, key, length, hash))
+                continue;
+            *found = 1;
+            struct persistent_node *clone = persistent_node_clone(node, node->entry_count, 0);
+            if (!clone)
+                return NULL;
+            persistent_entry_release(&clone->entries[i]);
+            persistent_node_take_entry(clone, i);
+            return clone;
+        }
+        return NULL;
+    }
+
+    uint32_t bit = persistent_node_bit(hash, shift);
+    if (node->datamap & bit)
+    {
+        unsigned index = persistent_node_index(node->datamap, bit);
+        if (!persistent_key_equals(node->entries[index].key, key, length, hash))
+            return NULL;
+        *found = 1;
+        struct persistent_node *clone = persistent_node_clone(node, node->entry_count, node->child_count);
+        if (!clone)
+            return NULL;
+        persistent_entry_release(&clone->entries[index]);
+        persistent_node_take_entry(clone, index);
+        clone->datamap &= ~bit;
+        return clone;
+    }
+    if (!(node->nodemap & bit))
+        return NULL;
+
+    unsigned child_index = persistent_node_index(node->nodemap, bit);
+    struct persistent_node *child = persistent_node_remove(node->children[child_index], shift + LIBJSON_PERSISTENT_BITS, key, length, hash, found);
+    if (!child)
+        return NULL;
+    if (child->entry_count == 1 && child->child_count == 0)
+    {
+        // A child left with a single entry is replaced by the entry
+        struct persistent_node *clone = persistent_node_clone(node, node->entry_count + 1, node->child_count);
+        if (!clone)
+        {
+            persistent_node_release(child);
+            return NULL;
+        }
+        persistent_node_release(clone->children[child_index]);
+        memmove(&clone->children[child_index], &clone->children[child_index + 1], (clone->child_count - child_index - 1) * sizeof(struct persistent_node *));
+        clone->child_count--;
+        clone->nodemap &= ~bit;
+        persistent_entry_retain(&child->entries[0]);
+        persistent_node_insert_entry(clone, persistent_node_index(clone->datamap, bit), &child->entries[0]);
+        clone->datamap |= bit;
+        persistent_node_release(child);
+        return clone;
+    }
+
+    struct persistent_node *clone = persistent_node_clone(node, node->entry_count, node->child_count);
+    if (!clone)
+    {
+        persistent_node_release(child);
+        return NULL;
+    }
+    persistent_node_release(clone->children[child_index]);
+    clone->children[child_index] = child;
+    return clone;
+}
+
+// Lists the entries of a trie, in no particular order
+static size_t persistent_node_collect(const struct persistent_node *node, const struct persistent_entry **entries, size_t count)
+{
+    for (unsigned i = 0; i < node->entry_count; i++)
+        entries[count++] = &node->entries[i];
+    for (unsigned i = 0; i < node->child_count; i++)
+        count = persistent_node_collect(node->children[i], entries, count);
+    return count;
+}
+
+static int persistent_entry_compare(const void *a, const void *b)
+{
+    uint64_t order_a = (*(const struct persistent_entry *const *)a)->order;
+    uint64_t order_b = (*(const struct persistent_entry *const *)b)->order;
+    return order_a < order_b ? -1 : order_a > order_b;
+}
+
+/**
+ * @subsection Persistent value functions
+ */
+
+struct json_persistent *json_persistent_array(void)
+{
+    return json_persistent_new(JSON_ARRAY);
+}
+
+struct json_persistent *json_persistent_object(void)
+{
+    return json_persistent_new(JSON_OBJECT);
+}
+
+// Persistent scalars hold their own copy of the value, whose lazy text is
+// decoded right away since versions are read by several threads
+static struct json_persistent *json_persistent_scalar_new(struct json *scalar)
+{
+    if (!scalar)
+        return NULL;
+    if (scalar->type == JSON_STRING && !json_string_borrow(scalar))
+    {
+        json_free(scalar);
+        return NULL;
+    }
+    struct json_persistent *value = json_persistent_new(scalar->type);
+    if (!value)
+    {
+        json_free(scalar);
+        return NULL;
+    }
+    value->scalar = scalar;
+    return value;
+}
+
+static struct json_persistent *json_persistent_from_cell(json_cell cell)
+{
+    if (json_cell_is_node(cell))
+        return json_persistent_from(json_cell_node(cell));
+    return json_persistent_scalar_new(json_number_new(NULL, json_cell_number(cell)));
+}
+
+struct json_persistent *json_persistent_from(const struct json *value)
+{
+    if (!value)
+        return NULL;
+    if (value->type != JSON_ARRAY && value->type != JSON_OBJECT)
+        return json_persistent_scalar_new(json_copy((struct json *)value));
+
+    struct json_persistent *result = json_persistent_new(value->type);
+    if (value->type == JSON_ARRAY)
+    {
+        // Cells are read as they are, to leave the value unchanged
+        int length = vector_json_length(value->value.array);
+        for (int i = 0; result && i < length; i++)
+        {
+            struct json_persistent *version = json_persistent_array_push(result, json_persistent_from_cell(json_cell_load(vector_json_get(value->value.array, i))));
+            json_persistent_free(result);
+            result = version;
+        }
+        return result;
+    }
+
+    size_t position = 0;
+    struct hash_table_entry *entry;
+    while (result && (entry = hash_table_next(value->value.object, &position)))
+    {
+        struct json_persistent *version = json_persistent_object_set_n(result, hash_table_entry_key(entry), hash_table_entry_key_length(entry), json_persistent_from_cell(json_cell_load(hash_table_entry_value(entry))));
+        json_persistent_free(result);
+        result = version;
+    }
+    return result;
+}
+
+struct json *json_persistent_to_json(const struct json_persistent *value)
+{
+    if (!value)
+        return NULL;
+    if (value->type == JSON_ARRAY)
+    {
+        struct json *array = json_array_new(NULL);
+        for (int i = 0; array && i < value->array.length; i++)
+        {
+            struct json *element = json_persistent_to_json(json_persistent_array_get(value, i));
+            if (!element || !json_array_push_cell(array, json_cell_from_node(element)))
+            {
+                json_free(element);
+                json_free(array);
+                return NULL;
+            }
+        }
+        return array;
+    }
+    if (value->type != JSON_OBJECT)
+        return json_copy(value->scalar);
+
+    struct json *object = json_object_new(NULL);
+    if (!object || !value->object.size)
+        return object;
+    const struct persistent_entry **entries = json_mem_alloc(value->object.size * sizeof(struct persistent_entry *));
+    if (!entries)
+    {
+        json_free(object);
+        return NULL;
+    }
+    size_t count = persistent_node_collect(value->object.root, entries, 0);
+    qsort(entries, count, sizeof(struct persistent_entry *), persistent_entry_compare);
+    for (size_t i = 0; i < count; i++)
+    {
+        struct json *member = json_persistent_to_json(entries[i]->value);
+        if (!member)
+        {
+            json_mem_free(entries);
+            json_free(object);
+            return NULL;
+        }
+        hash_table_set_n(object->value.object, entries[i]->key->text, entries[i]->key->length, json_cell_from_node(member));
+    }
+    json_mem_free(entries);
+    return object;
+}
+
+struct json_persistent *json_persistent_copy(const struct json_persistent *value)
+{
+    return value ? json_persistent_retain(value) : NULL;
+}
+
+void json_persistent_free(struct json_persistent *value)
+{
+    if (!value || !json_refs_release(&value->refs))
+        return;
+
+    switch (value->type)
+    {
+    case JSON_ARRAY:
+        persistent_chunk_release(value->array.root, value->array.shift);
+        persistent_chunk_release(value->array.tail, 0);
+        break;
+    case JSON_OBJECT:
+        persistent_node_release(value->object.root);
+        break;
+    default:
+        json_free(value->scalar);
+        break;
+    }
+    slab_free(value, sizeof(struct json_persistent));
+}
+
+int json_persistent_is_array(const struct json_persistent *value)
+{
+    return value && value->type == JSON_ARRAY;
+}
+
+int json_persistent_is_object(const struct json_persistent *value)
+{
+    return value && value->type == JSON_OBJECT;
+}
+
+const struct json *json_persistent_scalar(const struct json_persistent *value)
+{
+    if (!value || value->type == JSON_ARRAY || value->type == JSON_OBJECT)
+        return NULL;
+    return value->scalar;
+}
+
+int json_persistent_length(const struct json_persistent *value)
+{
+    if (json_persistent_is_array(value))
+        return value->array.length;
+    if (json_persistent_is_object(value))
+        return value->object.size;
+    return 0;
+}
+
+/**
+ * @subsection Persistent array functions
+ */
+
+struct json_persistent *json_persistent_array_get(const struct json_persistent *array, int index)
+{
+    if (!json_persistent_is_array(array) || index < 0 || index >= array->array.length)
+        return NULL;
+    return persistent_array_leaf(array, index)->slots[index & LIBJSON_PERSISTENT_MASK];
+}
+
+struct json_persistent *json_persistent_array_push(const struct json_persistent *array, struct json_persistent *value)
+{
+    if (!json_persistent_is_array(array) || !value || array->array.length == INT32_MAX)
+    {
+        json_persistent_free(value);
+        return NULL;
+    }
+
+    struct json_persistent *version = json_persistent_new(JSON_ARRAY);
+    if (!version)
+    {
+        json_persistent_free(value);
+        return NULL;
+    }
+    int length = array->array.length;
+    int tail_length = length - persistent_array_tail_offset(array);
+    version->array.length = length + 1;
+    version->array.shift = array->array.shift;
+    if (tail_length < LIBJSON_PERSISTENT_WIDTH)
+    {
+        // Room left in the tail
+        if (array->array.root)
+            json_refs_retain(&array->array.root->refs);
+        version->array.root = array->array.root;
+        version->array.tail = persistent_chunk_clone(array->array.tail, 0);
+        if (!version->array.tail)
+        {
+            json_persistent_free(version);
+            json_persistent_free(value);
+            return NULL;
+        }
+        version->array.tail->slots[tail_length] = value;
+        return version;
+    }
+
+    // The full tail moves into the tree, which gets a level when it is full
+    struct persistent_chunk *root = array->array.root;
+    if (root && (length >> LIBJSON_PERSISTENT_BITS) > (1 << array->array.shift))
+    {
+        root = persistent_chunk_new();
+        if (root)
+        {
+            json_refs_retain(&array->array.root->refs);
+            root->slots[0] = array->array.root;
+            root->slots[1] = persistent_chunk_path(array->array.shift, array->array.tail);
+            if (!root->slots[1])
+            {
+                persistent_chunk_release(root, array->array.shift + LIBJSON_PERSISTENT_BITS);
+                root = NULL;
+            }
+        }
+        version->array.shift += LIBJSON_PERSISTENT_BITS;
+    }
+    else
+    {
+        root = persistent_chunk_push_leaf(root, array->array.shift, length, array->array.tail);
+    }
+    version->array.root = root;
+    version->array.tail = persistent_chunk_new();
+    if (!root || !version->array.tail)
+    {
+        json_persistent_free(version);
+        json_persistent_free(value);
+        return NULL;
+    }
+    version->array.tail->slots[0] = value;
+    return version;
+}
+
+struct json_persistent *json_persistent_array_set(const struct json_persistent *array, int index, struct json_persistent *value)
+{
+    if (!json_persistent_is_array(array) || !value || index < 0 || index >= array->array.length)
+    {
+        json_persistent_free(value);
+        return NULL;
+    }
+
+    struct json_persistent *version = json_persistent_new(JSON_ARRAY);
+    if (!version)
+    {
+        json_persistent_free(value);
+        return NULL;
+    }
+    version->array.length = array->array.length;
+    version->array.shift = array->array.shift;
+    int tail_offset = persistent_array_tail_offset(array);
+    if (index >= tail_offset)
+    {
+        if (array->array.root)
+            json_refs_retain(&array->array.root->refs);
+        version->array.root = array->array.root;
+        version->array.tail = persistent_chunk_clone(array->array.tail, 0);
+        if (!version->array.tail)
+        {
+            json_persistent_free(version);
+            json_persistent_free(value);
+            return NULL;
+        }
+        persistent_chunk_replace(version->array.tail, index - tail_offset, value, 0);
+        return version;
+    }
+
+    json_refs_retain(&array->array.tail->refs);
+    version->array.tail = array->array.tail;
+    version->array.root = persistent_chunk_set(array->array.root, array->array.shift, index, value);
+    if (!version->array.root)
+    {
+        json_persistent_free(version);
+        json_persistent_free(value);
+        return NULL;
+    }
+    return version;
+}
+
+struct json_persistent *json_persistent_array_pop(const struct json_persistent *array)
+{
+    if (!json_persistent_is_array(array) || array->array.length == 0)
+        return NULL;
+
+    struct json_persistent *version = json_persistent_new(JSON_ARRAY);
+    if (!version || array->array.length == 1)
+        return version;
+    int length = array->array.length;
+    int tail_offset = persistent_array_tail_offset(array);
+    version->array.length = length - 1;
+    version->array.shift = array->array.shift;
+    if (length - tail_offset > 1)
+    {
+        if (array->array.root)
+            json_refs_retain(&array->array.root->refs);
+        version->array.root = array->array.root;
+        version->array.tail = persistent_chunk_clone(array->array.tail, 0);
+        if (!version->array.tail)
+        {
+            json_persistent_free(version);
+            return NULL;
+        }
+        persistent_chunk_replace(version->array.tail, length - tail_offset - 1, NULL, 0);
+        return version;
+    }
+
+    // The last leaf of the tree becomes the tail
+    version->array.tail = persistent_array_leaf(array, length - 2);
+    json_refs_retain(&version->array.tail->refs);
+    int empty = 0;
+    struct persistent_chunk *root = persistent_chunk_pop_leaf(array->array.root, array->array.shift, length, &empty);
+    if (!root && !empty)
+    {
+        json_persistent_free(version);
+        return NULL;
+    }
+    if (!root)
+        version->array.shift = LIBJSON_PERSISTENT_BITS;
+    if (root && version->array.shift > LIBJSON_PERSISTENT_BITS && !root->slots[1])
+    {
+        // A root left with a single child is replaced by the child
+        struct persistent_chunk *child = root->slots[0];
+        json_refs_retain(&child->refs);
+        persistent_chunk_release(root, version->array.shift);
+        root = child;
+        version->array.shift -= LIBJSON_PERSISTENT_BITS;
+    }
+    version->array.root = root;
+    return version;
+}
+
+/**
+ * @subsection Persistent object functions
+ */
+
+struct json_persistent *json_persistent_object_get(const struct json_persistent *object, const char *key)
+{
+    if (!key)
+        return NULL;
+    return json_persistent_object_get_n(object, key, strlen(key));
+}
+
+struct json_persistent *json_persistent_object_get_n(const struct json_persistent *object, const char *key, size_t length)
+{
+    if (!json_persistent_is_object(object) || !key || !object->object.root)
+        return NULL;
+    const struct persistent_entry *entry = persistent_node_find(object->object.root, key, length, hash_table_hash(key, length));
+    return entry ? entry->value : NULL;
+}
+
+struct json_persistent *json_persistent_object_set(const struct json_persistent *object, const char *key, struct json_persistent *value)
+{
+    if (!key)
+    {
+        json_persistent_free(value);
+        return NULL;
+    }
+    return json_persistent_object_set_n(object, key, strlen(key), value);
+}
+
+struct json_persistent *json_persistent_object_set_n(const struct json_persistent *object, const char *key, size_t length, struct json_persistent *value)
+{
+    struct persistent_entry entry = {NULL, 0, value};
+    if (!json_persistent_is_object(object) || !key || !value || object->object.size == INT32_MAX)
+    {
+        json_persistent_free(value);
+        return NULL;
+    }
+
+    struct json_persistent *version = json_persistent_new(JSON_OBJECT);
+    entry.key = persistent_key_new(key, length);
+    if (!version || !entry.key)
+    {
+        json_persistent_free(version);
+        json_mem_free(entry.key);
+        json_persistent_free(value);
+        return NULL;
+    }
+    entry.order = object->object.next_order;
+
+    int added = 0;
+    if (object->object.root)
+    {
+        version->object.root = persistent_node_set(object->object.root, 0, &entry, &added);
+    }
+    else if ((version->object.root = persistent_node_new(1, 0)))
+    {
+        persistent_node_insert_entry(version->object.root, 0, &entry);
+        version->object.root->datamap = persistent_node_bit(entry.key->hash, 0);
+        added = 1;
+    }
+    if (!version->object.root)
+    {
+        json_persistent_free(version);
+        persistent_entry_release(&entry);
+        return NULL;
+    }
+    version->object.size = object->object.size + added;
+    version->object.next_order = object->object.next_order + added;
+    return version;
+}
+
+struct json_persistent *json_persistent_object_remove(const struct json_persistent *object, const char *key)
+{
+    if (!json_persistent_is_object(object) || !key)
+        return NULL;
+
+    size_t length = strlen(key);
+    int found = 0;
+    struct persistent_node *root = NULL;
+    if (object->object.root)
+        root = persistent_node_remove(object->object.root, 0, key, length, hash_table_hash(key, length), &found);
+    if (!found)
+        return json_persistent_copy(object);
+    if (!root)
+        return NULL;
+
+    struct json_persistent *version = json_persistent_new(JSON_OBJECT);
+    if (!version)
+    {
+        persistent_node_release(root);
+        return NULL;
+    }
+    if (root->entry_count == 0 && root->child_count == 0)
+    {
+        persistent_node_release(root);
+        root = NULL;
+    }
+    version->object.root = root;
+    version->object.size = object->object.size - 1;
+    version->object.next_order = object->object.next_order;
+    return version;
+}
@@ -6,8 +6,11 @@
 
 struct json *json_read(FILE *in, char *errbuf)
 {
-    struct json_token token;
-    char linecol[64];
+    return json_read_opts(in, NULL, errbuf);
+}
+
+struct json *json_read_opts(FILE *in, const struct json_read_options *options, char *errbuf)
+{
     if (!in)
         return NULL;
     if (!errbuf)
@@ -15,19 +18,34 @@ struct json *json_read(FILE *in, char *errbuf)
     struct error_context errctx = {
         .message = errbuf,
         .line = 0,
-        .column = 0};
-    token = json_read_token(in, &errctx);
+        .column = 0,
+        .offset = 0,
+        .options = options};
+    return json_read_value(in, &errctx);
+}
+
+// Parses a single value using an already initialized context. On failure the
+// error message is prefixed with the position where parsing stopped.
+struct json *json_read_value(FILE *in, struct error_context *errctx)
+{
+    struct json_token token;
+    char linecol[64];
+    token = json_read_token(in, errctx);
     struct json *result = NULL;
-    if (token.type != JSON_TOKEN_INVALID && json_parser_json(in, &token, &result, &errctx))
+    if (token.type != JSON_TOKEN_INVALID && json_parser_json(in, &token, &result, errctx))
     {
         // Successfully parsed JSON
-        errbuf[0] = '\0';
+        errctx->message[0] = '\0';
         return result;
     }
-    int initial_message_length = strlen(errctx.message);
-    sprintf(linecol, "(%d:%d): ", errctx.line + 1, errctx.column);
-    strprep(errctx.message, linecol);
-    strprep(errctx.message, "Error parsing JSON ");
+    // Error paths leave the token they stopped at
+    json_mem_free(token.value);
+    // Later error paths may have replaced the message of the failed allocation
+    if (errctx->out_of_memory)
+        strcpy(errctx->message, "Out of memory.");
+    sprintf(linecol, "(%d:%d): ", errctx->line + 1, errctx->column);
+    strprep(errctx->message, linecol);
+    strprep(errctx->message, "Error parsing JSON ");
     if (result)
     {
         json_free(result);
@@ -37,6 +55,11 @@ struct json *json_read(FILE *in, char *errbuf)
 }
 
 struct json *json_read_string(const char *json_string, char *errbuf)
+{
+    return json_read_string_opts(json_string, NULL, errbuf);
+}
+
+struct json *json_read_string_opts(const char *json_string, const struct json_read_options *options, char *errbuf)
 {
     if (!json_string)
         return NULL;
@@ -45,33 +68,93 @@ struct json *json_read_string(const char *json_string, char *errbuf)
     if (!memfile)
         return NULL;
 
-    struct json *result = json_read(memfile, errbuf);
+    struct json *result = json_read_opts(memfile, options, errbuf);
     fclose(memfile);
     return result;
 }
 
+// Takes the decoded text out of a string token, along with its length in
+// bytes when requested, since it may contain NUL bytes
+static char *json_token_text(struct json_token *token, size_t *length)
+{
+    char *text = token->value;
+    if (token->escaped)
+    {
+        text = json_unescape(token->value, length);
+        json_mem_free(token->value);
+    }
+    else if (length)
+    {
+        *length = strlen(text);
+    }
+    token->value = NULL;
+    return text;
+}
+
+// Records a failed allocation, so that it is not reported as a syntax error
+static int json_parser_out_of_memory(struct error_context *errctx)
+{
+    errctx->out_of_memory = 1;
+    return 0;
+}
+
+// Frees a container along with a value that could not be added to it
+static int json_parser_discard(struct json **dest, json_cell value, struct error_context *errctx)
+{
+    json_cell_free(value);
+    json_free(*dest);
+    *dest = NULL;
+    return json_parser_out_of_memory(errctx);
+}
+
+// Parses an element of an array or a value of an object into a cell. Plain
+// numbers are stored inline, unless spans are recorded, which need a node for
+// every value.
+static int json_parser_cell(FILE *in, struct json_token *token, json_cell *dest, struct error_context *errctx)
+{
+    if (token->type == JSON_TOKEN_NUMBER && !errctx->spans && !(errctx->options && errctx->options->lazy_numbers))
+    {
+        *dest = json_cell_from_number(atof(token->value));
+        json_mem_free(token->value);
+        token->value = NULL;
+        return 1;
+    }
+    struct json *node = NULL;
+    if (!json_parser_json(in, token, &node, errctx))
+        return 0;
+    *dest = json_cell_from_node(node);
+    return 1;
+}
+
 int json_parser_json(FILE *in, struct json_token *token, struct json **dest, struct error_context *errctx)
 {
-    return json_parser_literal(in, token, dest, errctx) || json_parser_array(in, token, dest, errctx) || json_parser_object(in, token, dest, errctx);
+    struct json_span *span = json_span_open(errctx, token);
+    int parsed = json_parser_literal(in, token, dest, errctx) || json_parser_array(in, token, dest, errctx) || json_parser_object(in, token, dest, errctx);
+    json_span_close(errctx, span, parsed ? *dest : NULL);
+    return parsed;
 }
 
 int json_parser_array(FILE *in, struct json_token *token, struct json **dest, struct error_context *errctx)
 {
     if (token->type == JSON_TOKEN_ARRAY_START)
     {
-        *dest = __json_array_macro(NULL); // Create empty array
+        *dest = json_array_new(json_context_arena(errctx)); // Create empty array
+        if (!*dest)
+            return json_parser_out_of_memory(errctx);
         *token = json_read_token(in, errctx);
-        struct json *element = NULL;
-        if (json_parser_json(in, token, &element, errctx))
+        json_cell element;
+        if (json_parser_cell(in, token, &element, errctx))
         {
-            json_array_push(*dest, element);
+            if (!json_array_push_cell(*dest, element))
+                return json_parser_discard(dest, element, errctx);
             *token = json_read_token(in, errctx);
             while (token->type == JSON_TOKEN_COMMA)
             {
                 *token = json_read_token(in, errctx);
-                if (json_parser_json(in, token, &element, errctx))
+                if (json_parser_cell(in, token, &element, errctx))
                 {
-                    json_array_push(*dest, element);
+                    if (!json_array_push_cell(*dest, element))
+                        return json_parser_discard(dest, element, errctx);
                     *token = json_read_token(in, errctx);
                 }
                 else // Error: Unexpected inner JSON
@@ -103,7 +186,9 @@ int json_parser_object(FILE *in, struct json_token *token, struct json **dest, s
 {
     if (token->type == JSON_TOKEN_OBJECT_START)
     {
-        *dest = __json_object_macro(NULL); // Create empty object
+        *dest = json_object_new(json_context_arena(errctx)); // Create empty object
+        if (!*dest)
+            return json_parser_out_of_memory(errctx);
         *token = json_read_token(in, errctx);
 
         // Check for empty object first
@@ -162,29 +247,37 @@ int json_parser_key_value(FILE *in, struct json_token *token, struct json *objec
 {
     if (token->type == JSON_TOKEN_STRING)
     {
-        char *key = strdup(token->value);
+        size_t key_length;
+        char *key = json_token_text(token, &key_length);
+        if (!key)
+            return json_parser_out_of_memory(errctx);
         *token = json_read_token(in, errctx);
         if (token->type == JSON_TOKEN_COLON)
         {
             *token = json_read_token(in, errctx);
-            struct json *value = NULL;
-            if (json_parser_json(in, token, &value, errctx))
+            json_cell value;
+            if (json_parser_cell(in, token, &value, errctx))
             {
-                json_object_set(object, key, value);
-                free(key);
+                int set = hash_table_set_n(object->value.object, key, key_length, value);
+                json_mem_free(key);
+                if (!set)
+                {
+                    json_cell_free(value);
+                    return json_parser_out_of_memory(errctx);
+                }
                 return 1;
             }
             else
             {
                 strcpy(errctx->message, "Expected JSON value after ':' in object.");
-                free(key);
+                json_mem_free(key);
                 return 0;
             }
         }
         else
         {
             strcpy(errctx->message, "Expecting ':' after key.");
-            free(key);
+            json_mem_free(key);
             return 0;
         }
     }
@@ -213,13 +306,43 @@ int json_parser_literal(FILE *in, struct json_token *token, struct json **dest,
     }
     else if (token->type == JSON_TOKEN_NUMBER)
     {
-        *dest = json_number(atof(token->value));
-        return 1;
+        if (errctx && errctx->options && errctx->options->lazy_numbers)
+        {
+            // The literal is written back verbatim, so it must be valid JSON
+            if (!json_number_literal_valid(token->value))
+            {
+                strcpy(errctx->message, "Invalid number literal.");
+                json_mem_free(token->value);
+                token->value = NULL;
+                return 0;
+            }
+            // The node takes ownership of the token text
+            *dest = json_number_literal(json_context_arena(errctx), token->value);
+            token->value = NULL;
+            return *dest ? 1 : json_parser_out_of_memory(errctx);
+        }
+        *dest = json_number_new(json_context_arena(errctx), atof(token->value));
+        json_mem_free(token->value);
+        token->value = NULL;
+        return *dest ? 1 : json_parser_out_of_memory(errctx);
     }
     else if (token->type == JSON_TOKEN_STRING)
     {
-        *dest = json_string(token->value);
-        return 1;
+        if (errctx && errctx->options && errctx->options->lazy_strings)
+        {
+            // Unescaped text is its own raw form, escaped text is only
+            // decoded on access
+            if (token->escaped)
+                *dest = json_string_take(json_context_arena(errctx), NULL, token->value);
+            else
+                *dest = json_string_take(json_context_arena(errctx), token->value, token->value);
+        }
+        else
+        {
+            *dest = json_string_take(json_context_arena(errctx), json_token_text(token, NULL), NULL);
+        }
+        token->value = NULL;
+        return *dest ? 1 : json_parser_out_of_memory(errctx);
     }
     return 0;
 }
@@ -240,6 +363,7 @@ struct json_token json_read_token(FILE *in, struct error_context *errctx)
         token.type = JSON_TOKEN_EOF;
         return token;
     }
+    token.start = errctx->offset - 1;
 
     switch (c)
     {
@@ -324,108 +448,72 @@ struct json_token json_read_token(FILE *in, struct error_context *errctx)
     }
     case '"':
     {
-        char *str = NULL;
-        struct linked_list *char_list = NULL, *char_list_ptr = NULL;
+        // Keep the text as it appears in the source: escape sequences are only
+        // validated here and decoded by the parser when needed
+        struct string_buffer buffer;
+        string_buffer_init(&buffer);
+        token.type = JSON_TOKEN_STRING;
         i = 1;
         while ((c = update_error_context(errctx, fgetc(in), i++)) != '"')
         {
+            if (c == EOF)
+            {
+                token.type = JSON_TOKEN_INVALID;
+                break;
+            }
             if (c == '\\')
             {
-                c = update_error_context(errctx, fgetc(in), i++);
-                switch (c)
+                token.escaped = 1;
+                if (!string_buffer_push(&buffer, c))
                 {
-                case 'b':
-                    c = '\b';
-                    break;
-                case 'f':
-                    c = '\f';
-                    break;
-                case 'n':
-                    c = '\n';
-                    break;
-                case 'r':
-                    c = '\r';
-                    break;
-                case 't':
-                    c = '\t';
-                    break;
-                case '\\':
-                    c = '\\';
-                    break;
-                case '"':
-                    c = '"';
+                    json_parser_out_of_memory(errctx);
+                    token.type = JSON_TOKEN_INVALID;
                     break;
-                case 'u':
+                }
+                c = update_error_context(errctx, fgetc(in), i++);
+                if (c == 'u')
                 {
                     // Unicode escape sequence \uXXXX
-                    char hex[5] = {0};
-                    for (int j = 0; j < 4; j++)
+                    if (!string_buffer_push(&buffer, c))
                     {
-                        int hex_char = update_error_context(errctx, fgetc(in), i++);
-                        if (isxdigit(hex_char))
-                        {
-                            hex[j] = hex_char;
-                        }
-                        else
+                        json_parser_out_of_memory(errctx);
+                        token.type = JSON_TOKEN_INVALID;
+                        break;
+                    }
+                    for (int j = 0; j < 4 && token.type != JSON_TOKEN_INVALID; j++)
+                    {
+                        c = update_error_context(errctx, fgetc(in), i++);
+                        if (!isxdigit(c))
+                            token.type = JSON_TOKEN_INVALID;
+                        else if (!string_buffer_push(&buffer, c))
                         {
+                            json_parser_out_of_memory(errctx);
                             token.type = JSON_TOKEN_INVALID;
-                            if (char_list)
-                                linked_list_free(char_list, NULL);
-                            return token;
                         }
                     }
-                    c = (int)strtol(hex, NULL, 16);
-                    break;
+                    if (token.type == JSON_TOKEN_INVALID)
+                        break;
+                    continue;
                 }
-                default: // Error: Invalid escape sequence
+                if (c == EOF || c == '\0' || !strchr("bfnrt\\\"/", c)) // Error: Invalid escape sequence
+                {
                     token.type = JSON_TOKEN_INVALID;
-                    if (char_list)
-                        linked_list_free(char_list, NULL);
-                    return token;
+                    break;
                 }
             }
-            if (char_list)
-            {
-                char_list_ptr = linked_list_insert(char_list_ptr, (void *)(long)c);
-            }
-            else
-            {
-                char_list = linked_list_new((void *)(long)c);
-                char_list_ptr = char_list;
-            }
-        }
-        if (char_list)
-        {
-            int length = linked_list_length(char_list);
-            str = (char *)malloc(length + 1);
-            if (str)
+            if (!string_buffer_push(&buffer, c))
             {
-                struct linked_list *node = char_list;
-                for (int j = 0; j < length; j++)
-                {
-                    str[j] = (char)(long)linked_list_value(node);
-                    node = linked_list_next(node);
-                }
-                str[length] = '\0';
-                token.value = str;
-                token.type = JSON_TOKEN_STRING;
+                json_parser_out_of_memory(errctx);
+                token.type = JSON_TOKEN_INVALID;
+                break;
             }
-            linked_list_free(char_list, NULL);
         }
-        else
+        if (token.type == JSON_TOKEN_STRING && !(token.value = string_buffer_take(&buffer)))
+            json_parser_out_of_memory(errctx);
+        if (!token.value)
         {
-            // Empty string
-            str = (char *)malloc(1);
-            if (str)
-            {
-                str[0] = '\0';
-                token.value = str;
-                token.type = JSON_TOKEN_STRING;
-            }
-            else
-            {
-                token.type = JSON_TOKEN_INVALID;
-            }
+            token.type = JSON_TOKEN_INVALID;
+            string_buffer_free(&buffer);
         }
         break;
     }
@@ -434,7 +522,7 @@ struct json_token json_read_token(FILE *in, struct error_context *errctx)
         // Check if this could be a valid number (must start with digit or minus)
         if (isdigit(c) || c == '-')
         {
-            ungetc(c, in);
+            json_ungetc(c, in, errctx);
             char buffer[32];
             int j = 0;
             i = 0; // Because of ungetc, we need to reset i
@@ -453,14 +541,16 @@ struct json_token json_read_token(FILE *in, struct error_context *errctx)
             }
             if (c != EOF)
             {
-                ungetc(c, in);
+                json_ungetc(c, in, errctx);
                 i--; // Adjust index for ungetc
             }
             buffer[j] = '\0';
             if (j > 0)
             {
-                token.value = strdup(buffer);
-                token.type = JSON_TOKEN_NUMBER;
+                token.value = json_mem_strdup(buffer);
+                token.type = token.value ? JSON_TOKEN_NUMBER : JSON_TOKEN_INVALID;
+                if (!token.value)
+                    json_parser_out_of_memory(errctx);
             }
             else
             {
@@ -476,7 +566,7 @@ struct json_token json_read_token(FILE *in, struct error_context *errctx)
     }
     if (token.type == JSON_TOKEN_INVALID)
     {
-        errctx->message[i] = '\0';
+        errctx->message[i < LIBJSON_TOKEN_ECHO_MAX ? i : LIBJSON_TOKEN_ECHO_MAX - 1] = '\0';
         strprep(errctx->message, error);
     }
     return token;
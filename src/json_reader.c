@@ -0,0 +1,269 @@
+#include "json_internal.h"
+
+#include <sys/types.h>
+
+/**
+ * @section JSON stream reading functions
+ */
+
+struct json_reader
+{
+    FILE *in;
+    // Stream position the reader was created at, or -1 if not seekable
+    off_t start;
+    struct json_read_options options;
+    long long offset;
+    int line;
+    int column;
+    // Number of arrays entered whose elements are being read
+    int depth;
+    // Whether an element of the innermost entered array was already read
+    int expect_comma;
+};
+
+// Skips whitespace and record separators between values. Returns 0 at the
+// end of the stream.
+static int json_skip_separators(FILE *in, struct error_context *errctx)
+{
+    int c;
+    while ((c = update_error_context(errctx, fgetc(in), 0)) != EOF)
+    {
+        if (!isspace(c) && c != LIBJSON_RECORD_SEPARATOR)
+        {
+            json_ungetc(c, in, errctx);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static struct json *json_read_next_value(FILE *in, struct error_context *errctx)
+{
+    if (!json_skip_separators(in, errctx))
+    {
+        // Clean end of stream
+        errctx->message[0] = '\0';
+        return NULL;
+    }
+    return json_read_value(in, errctx);
+}
+
+struct json *json_read_next(FILE *in, char *errbuf)
+{
+    if (!in)
+        return NULL;
+    if (!errbuf)
+        errbuf = __default_errbuf;
+    struct error_context errctx = {
+        .message = errbuf,
+        .line = 0,
+        .column = 0,
+        .offset = 0,
+        .options = NULL};
+    return json_read_next_value(in, &errctx);
+}
+
+struct json_reader *json_reader_new(FILE *in, const struct json_read_options *options)
+{
+    if (!in)
+        return NULL;
+    struct json_reader *reader = json_mem_alloc(sizeof(struct json_reader));
+    if (!reader)
+        return NULL;
+
+    reader->in = in;
+    reader->start = ftello(in);
+    if (options)
+        reader->options = *options;
+    else
+        memset(&reader->options, 0, sizeof(reader->options));
+    reader->offset = 0;
+    reader->line = 0;
+    reader->column = 0;
+    reader->depth = 0;
+    reader->expect_comma = 0;
+    return reader;
+}
+
+static void json_reader_context(struct json_reader *reader, struct error_context *errctx, char *errbuf)
+{
+    // Positions keep counting across values so errors point into the stream
+    errctx->message = errbuf;
+    errctx->line = reader->line;
+    errctx->column = reader->column;
+    errctx->offset = reader->offset;
+    errctx->options = &reader->options;
+    errctx->spans = NULL;
+    errctx->out_of_memory = 0;
+}
+
+static void json_reader_update(struct json_reader *reader, struct error_context *errctx)
+{
+    reader->offset = errctx->offset;
+    reader->line = errctx->line;
+    reader->column = errctx->column;
+}
+
+static void json_reader_error(struct error_context *errctx, const char *message)
+{
+    sprintf(errctx->message, "Error parsing JSON (%d:%d): %s", errctx->line + 1, errctx->column, message);
+}
+
+// Reads the token that starts the next element of the innermost entered
+// array. Returns 0 at the end of the array or on error.
+static int json_reader_element_token(struct json_reader *reader, struct json_token *token, struct error_context *errctx)
+{
+    *token = json_read_token(reader->in, errctx);
+    if (token->type == JSON_TOKEN_ARRAY_END)
+    {
+        // The array just left is an element of its parent
+        reader->depth--;
+        reader->expect_comma = 1;
+        errctx->message[0] = '\0';
+        return 0;
+    }
+    if (reader->expect_comma)
+    {
+        if (token->type != JSON_TOKEN_COMMA)
+        {
+            json_reader_error(errctx, "Expecting ']' or ','.");
+            json_mem_free(token->value);
+            token->value = NULL;
+            return 0;
+        }
+        *token = json_read_token(reader->in, errctx);
+    }
+    return 1;
+}
+
+struct json *json_reader_next(struct json_reader *reader, char *errbuf)
+{
+    if (!reader)
+        return NULL;
+    if (!errbuf)
+        errbuf = __default_errbuf;
+    struct error_context errctx;
+    json_reader_context(reader, &errctx, errbuf);
+
+    struct json *result = NULL;
+    if (reader->depth == 0)
+    {
+        result = json_read_next_value(reader->in, &errctx);
+    }
+    else
+    {
+        struct json_token token;
+        if (json_reader_element_token(reader, &token, &errctx))
+        {
+            if (token.type != JSON_TOKEN_INVALID && json_parser_json(reader->in, &token, &result, &errctx))
+            {
+                errbuf[0] = '\0';
+                reader->expect_comma = 1;
+            }
+            else if (token.type == JSON_TOKEN_INVALID || token.type == JSON_TOKEN_ARRAY_START || token.type == JSON_TOKEN_OBJECT_START)
+            {
+                // Keep the message of the tokenizer or nested parser
+                char linecol[64];
+                sprintf(linecol, "(%d:%d): ", errctx.line + 1, errctx.column);
+                strprep(errctx.message, linecol);
+                strprep(errctx.message, "Error parsing JSON ");
+                result = NULL;
+            }
+            else
+            {
+                json_reader_error(&errctx, "Expected JSON value in array.");
+                result = NULL;
+            }
+            if (!result)
+                json_mem_free(token.value);
+        }
+    }
+    json_reader_update(reader, &errctx);
+    return result;
+}
+
+int json_reader_enter_array(struct json_reader *reader, char *errbuf)
+{
+    if (!reader)
+        return 0;
+    if (!errbuf)
+        errbuf = __default_errbuf;
+    struct error_context errctx;
+    json_reader_context(reader, &errctx, errbuf);
+
+    struct json_token token = {0};
+    int entered = 0;
+    if (reader->depth == 0)
+    {
+        if (json_skip_separators(reader->in, &errctx))
+            token = json_read_token(reader->in, &errctx);
+        else
+            token.type = JSON_TOKEN_EOF;
+        entered = token.type == JSON_TOKEN_ARRAY_START;
+    }
+    else if (json_reader_element_token(reader, &token, &errctx))
+    {
+        entered = token.type == JSON_TOKEN_ARRAY_START;
+    }
+
+    if (entered)
+    {
+        reader->depth++;
+        reader->expect_comma = 0;
+        errbuf[0] = '\0';
+    }
+    else
+    {
+        json_reader_error(&errctx, "Expecting '['.");
+        json_mem_free(token.value);
+    }
+    json_reader_update(reader, &errctx);
+    return entered;
+}
+
+int json_reader_depth(const struct json_reader *reader)
+{
+    return reader ? reader->depth : 0;
+}
+
+void json_reader_checkpoint(const struct json_reader *reader, struct json_checkpoint *checkpoint)
+{
+    if (!reader || !checkpoint)
+        return;
+    checkpoint->offset = reader->offset;
+    checkpoint->line = reader->line;
+    checkpoint->column = reader->column;
+    checkpoint->depth = reader->depth;
+    checkpoint->expect_comma = reader->expect_comma;
+}
+
+int json_reader_restore(struct json_reader *reader, const struct json_checkpoint *checkpoint, char *errbuf)
+{
+    if (!reader || !checkpoint)
+        return 0;
+    if (!errbuf)
+        errbuf = __default_errbuf;
+    if (reader->start < 0 || checkpoint->offset < 0 || checkpoint->depth < 0 ||
+        fseeko(reader->in, reader->start + checkpoint->offset, SEEK_SET) != 0)
+    {
+        strcpy(errbuf, "Error restoring checkpoint: stream is not seekable.");
+        return 0;
+    }
+    reader->offset = checkpoint->offset;
+    reader->line = checkpoint->line;
+    reader->column = checkpoint->column;
+    reader->depth = checkpoint->depth;
+    reader->expect_comma = checkpoint->expect_comma;
+    errbuf[0] = '\0';
+    return 1;
+}
+
+long long json_reader_offset(const struct json_reader *reader)
+{
+    return reader ? reader->offset : 0;
+}
+
+void json_reader_free(struct json_reader *reader)
+{
+    json_mem_free(reader);
+}
@@ -0,0 +1,287 @@
+#include "json_internal.h"
+
+/**
+ * @section JSON event reading functions
+ */
+
+struct json_sax_parser
+{
+    FILE *in;
+    const struct json_sax_handler *handler;
+    void *ctx;
+    struct error_context *errctx;
+};
+
+// Invokes an optional callback, which stops parsing by returning 0
+#define json_sax_emit(parser, callback, ...) \
+    (!(parser)->handler->callback || (parser)->handler->callback(__VA_ARGS__))
+
+static int json_sax_fail(struct json_sax_parser *parser, const char *message)
+{
+    strcpy(parser->errctx->message, message);
+    return 0;
+}
+
+// Skips whitespace and returns the next character without consuming it
+static int json_sax_peek(struct json_sax_parser *parser)
+{
+    int c;
+    while (isspace(c = update_error_context(parser->errctx, fgetc(parser->in), 0)))
+        ;
+    json_ungetc(c, parser->in, parser->errctx);
+    return c;
+}
+
+// Reads 4 hexadecimal digits of a \uXXXX escape. Returns -1 if invalid.
+static long json_sax_hex4(struct json_sax_parser *parser)
+{
+    char hex[5] = {0};
+    for (int i = 0; i < 4; i++)
+    {
+        int c = update_error_context(parser->errctx, fgetc(parser->in), 0);
+        if (!isxdigit(c))
+            return -1;
+        hex[i] = (char)c;
+    }
+    return strtol(hex, NULL, 16);
+}
+
+// Streams the body of a string value, after its opening quote, decoding
+// escapes into chunks of at most LIBJSON_SAX_CHUNK_SIZE bytes
+static int json_sax_string(struct json_sax_parser *parser)
+{
+    char chunk[LIBJSON_SAX_CHUNK_SIZE];
+    size_t length = 0;
+    long high_surrogate = -1;
+    int c;
+
+    while ((c = update_error_context(parser->errctx, fgetc(parser->in), 0)) != '"')
+    {
+        // Keep room for a held back high surrogate and the escape after it,
+        // both encoded in up to 3 bytes
+        if (length > LIBJSON_SAX_CHUNK_SIZE - 7)
+        {
+            if (!json_sax_emit(parser, string_chunk, chunk, length, 0, parser->ctx))
+                return json_sax_fail(parser, "Parsing stopped by handler.");
+            length = 0;
+        }
+        if (c == EOF)
+            return json_sax_fail(parser, "Unterminated string.");
+
+        long codepoint = -1;
+        if (c == '\\')
+        {
+            c = update_error_context(parser->errctx, fgetc(parser->in), 0);
+            switch (c)
+            {
+            case 'b':
+                c = '\b';
+                break;
+            case 'f':
+                c = '\f';
+                break;
+            case 'n':
+                c = '\n';
+                break;
+            case 'r':
+                c = '\r';
+                break;
+            case 't':
+                c = '\t';
+                break;
+            case '"':
+            case '\\':
+            case '/':
+                break;
+            case 'u':
+                codepoint = json_sax_hex4(parser);
+                if (codepoint < 0)
+                    return json_sax_fail(parser, "Invalid unicode escape sequence.");
+                break;
+            default:
+                return json_sax_fail(parser, "Invalid escape sequence.");
+            }
+        }
+
+        // A high surrogate is held back until its low surrogate comes
+        if (high_surrogate >= 0)
+        {
+            if (codepoint >= 0xDC00 && codepoint <= 0xDFFF)
+            {
+                length += utf8_encode(0x10000 + ((high_surrogate - 0xD800) << 10) + (codepoint - 0xDC00), chunk + length);
+                high_surrogate = -1;
+                continue;
+            }
+            length += utf8_encode(high_surrogate, chunk + length);
+            high_surrogate = -1;
+        }
+        if (codepoint >= 0xD800 && codepoint <= 0xDBFF)
+            high_surrogate = codepoint;
+        else if (codepoint >= 0)
+            length += utf8_encode(codepoint, chunk + length);
+        else
+            chunk[length++] = (char)c;
+    }
+    if (high_surrogate >= 0)
+        length += utf8_encode(high_surrogate, chunk + length);
+
+    if (!json_sax_emit(parser, string_chunk, chunk, length, 1, parser->ctx))
+        return json_sax_fail(parser, "Parsing stopped by handler.");
+    return 1;
+}
+
+static int json_sax_value(struct json_sax_parser *parser);
+
+static int json_sax_array(struct json_sax_parser *parser)
+{
+    if (!json_sax_emit(parser, start_array, parser->ctx))
+        return json_sax_fail(parser, "Parsing stopped by handler.");
+
+    if (json_sax_peek(parser) == ']')
+        json_read_token(parser->in, parser->errctx);
+    else
+    {
+        struct json_token token;
+        do
+        {
+            if (!json_sax_value(parser))
+                return 0;
+            token = json_read_token(parser->in, parser->errctx);
+        } while (token.type == JSON_TOKEN_COMMA);
+        if (token.type != JSON_TOKEN_ARRAY_END)
+        {
+            json_mem_free(token.value);
+            return json_sax_fail(parser, "Expecting ']' or ','.");
+        }
+    }
+
+    if (!json_sax_emit(parser, end_array, parser->ctx))
+        return json_sax_fail(parser, "Parsing stopped by handler.");
+    return 1;
+}
+
+static int json_sax_object(struct json_sax_parser *parser)
+{
+    if (!json_sax_emit(parser, start_object, parser->ctx))
+        return json_sax_fail(parser, "Parsing stopped by handler.");
+
+    struct json_token token = json_read_token(parser->in, parser->errctx);
+    if (token.type != JSON_TOKEN_OBJECT_END)
+    {
+        while (1)
+        {
+            if (token.type != JSON_TOKEN_STRING)
+            {
+                json_mem_free(token.value);
+                return json_sax_fail(parser, "Expecting string key in object.");
+            }
+            // Keys are short enough to be read whole
+            char *key = token.escaped ? json_unescape(token.value, NULL) : token.value;
+            if (key != token.value)
+                json_mem_free(token.value);
+            int accepted = json_sax_emit(parser, key, key, parser->ctx);
+            json_mem_free(key);
+            if (!accepted)
+                return json_sax_fail(parser, "Parsing stopped by handler.");
+
+            token = json_read_token(parser->in, parser->errctx);
+            if (token.type != JSON_TOKEN_COLON)
+            {
+                json_mem_free(token.value);
+                return json_sax_fail(parser, "Expecting ':' after key.");
+            }
+            if (!json_sax_value(parser))
+                return 0;
+
+            token = json_read_token(parser->in, parser->errctx);
+            if (token.type != JSON_TOKEN_COMMA)
+                break;
+            token = json_read_token(parser->in, parser->errctx);
+        }
+        if (token.type != JSON_TOKEN_OBJECT_END)
+        {
+            json_mem_free(token.value);
+            return json_sax_fail(parser, "Expecting '}' or ','.");
+        }
+    }
+
+    if (!json_sax_emit(parser, end_object, parser->ctx))
+        return json_sax_fail(parser, "Parsing stopped by handler.");
+    return 1;
+}
+
+static int json_sax_value(struct json_sax_parser *parser)
+{
+    // String values are streamed instead of being read as a whole token
+    if (json_sax_peek(parser) == '"')
+    {
+        update_error_context(parser->errctx, fgetc(parser->in), 0);
+        return json_sax_string(parser);
+    }
+
+    int accepted = 1;
+    struct json_token token = json_read_token(parser->in, parser->errctx);
+    switch (token.type)
+    {
+    case JSON_TOKEN_NULL:
+        accepted = json_sax_emit(parser, null_value, parser->ctx);
+        break;
+    case JSON_TOKEN_TRUE:
+        accepted = json_sax_emit(parser, boolean_value, 1, parser->ctx);
+        break;
+    case JSON_TOKEN_FALSE:
+        accepted = json_sax_emit(parser, boolean_value, 0, parser->ctx);
+        break;
+    case JSON_TOKEN_NUMBER:
+        if (!json_number_literal_valid(token.value))
+        {
+            json_mem_free(token.value);
+            return json_sax_fail(parser, "Invalid number literal.");
+        }
+        accepted = json_sax_emit(parser, number_value, token.value, parser->ctx);
+        json_mem_free(token.value);
+        break;
+    case JSON_TOKEN_ARRAY_START:
+        return json_sax_array(parser);
+    case JSON_TOKEN_OBJECT_START:
+        return json_sax_object(parser);
+    case JSON_TOKEN_INVALID:
+        // The tokenizer already described the error
+        return 0;
+    default:
+        return json_sax_fail(parser, "Expected JSON value.");
+    }
+    if (!accepted)
+        return json_sax_fail(parser, "Parsing stopped by handler.");
+    return 1;
+}
+
+int json_sax_read(FILE *in, const struct json_sax_handler *handler, void *ctx, char *errbuf)
+{
+    char linecol[64];
+    if (!in || !handler)
+        return 0;
+    if (!errbuf)
+        errbuf = __default_errbuf;
+    struct error_context errctx = {
+        .message = errbuf,
+        .line = 0,
+        .column = 0,
+        .offset = 0,
+        .options = NULL};
+    struct json_sax_parser parser = {
+        .in = in,
+        .handler = handler,
+        .ctx = ctx,
+        .errctx = &errctx};
+
+    if (json_sax_value(&parser))
+    {
+        errbuf[0] = '\0';
+        return 1;
+    }
+    sprintf(linecol, "(%d:%d): ", errctx.line + 1, errctx.column);
+    strprep(errctx.message, linecol);
+    strprep(errctx.message, "Error parsing JSON ");
+    return 0;
+}
@@ -42,6 +42,8 @@ double json_double_value(const struct json *node)
 {
     if (!node || node->type != JSON_NUMBER)
         return 0.0;
+    if (node->raw)
+        return strtod(node->raw, NULL);
     return node->value.number;
 }
 
@@ -49,14 +51,48 @@ int json_int_value(const struct json *node)
 {
     if (!node || node->type != JSON_NUMBER)
         return 0;
+    if (node->raw)
+        return (int)json_int64_value(node);
     return (int)node->value.number;
 }
 
+long long json_int64_value(const struct json *node)
+{
+    if (!node || node->type != JSON_NUMBER)
+        return 0;
+    if (!node->raw)
+        return (long long)node->value.number;
+    // Plain integer literals are converted exactly, anything with a fraction
+    // or exponent goes through double
+    if (strpbrk(node->raw, ".eE"))
+        return (long long)strtod(node->raw, NULL);
+    return strtoll(node->raw, NULL, 10);
+}
+
+const char *json_number_text(const struct json *node)
+{
+    if (!node || node->type != JSON_NUMBER)
+        return NULL;
+    return node->raw;
+}
+
 const char *json_string_value(const struct json *node)
 {
     if (!node || node->type != JSON_STRING)
         return NULL;
-    return strdup(node->value.string);
+    const char *data = json_string_data(node);
+    if (!data)
+        return json_unescape(node->raw, NULL);
+    return json_mem_strdup(data);
+}
+
+const char *json_string_borrow(const struct json *node)
+{
+    if (!node || node->type != JSON_STRING)
+        return NULL;
+    if (!json_string_data(node))
+        ((struct json *)node)->value.string = json_unescape(node->raw, NULL);
+    return json_string_data(node);
 }
 
 const char *json_error(char *errbuf)
@@ -66,5 +102,5 @@ const char *json_error(char *errbuf)
     if (!errbuf || strlen(errbuf) == 0)
         return NULL;
 
-    return strdup(errbuf);
+    return json_mem_strdup(errbuf);
 }
@@ -9,6 +9,18 @@
  * Handles escaping of control characters, double quotes, and backslashes
  */
 int json_write_escaped_string(const char *str, FILE *out)
+{
+    if (!str || !out)
+        return -1;
+
+    return json_write_escaped_bytes(str, strlen(str), out);
+}
+
+/**
+ * Same as json_write_escaped_string(), for text of a known length that may
+ * contain NUL bytes
+ */
+int json_write_escaped_bytes(const char *str, size_t length, FILE *out)
 {
     if (!str || !out)
         return -1;
@@ -21,7 +33,8 @@ int json_write_escaped_string(const char *str, FILE *out)
         return -1;
     bytes_written++;
 
-    for (const unsigned char *ptr = (const unsigned char *)str; *ptr; ptr++)
+    const unsigned char *end = (const unsigned char *)str + length;
+    for (const unsigned char *ptr = (const unsigned char *)str; ptr < end; ptr++)
     {
         switch (*ptr)
         {
@@ -94,32 +107,58 @@ int json_write_boolean(struct json *node, FILE *out)
     return fprintf(out, node->value.boolean ? "true" : "false");
 }
 
-int json_write_number(struct json *node, FILE *out)
+static int json_write_double(double value, FILE *out)
 {
-    if (!node || !out)
-        return -1;
-
     // Check if the number is an integer to avoid printing decimals unnecessarily
     double intpart;
-    if (modf(node->value.number, &intpart) == 0.0)
+    if (modf(value, &intpart) == 0.0)
     {
-        return fprintf(out, "%.0f", node->value.number);
+        return fprintf(out, "%.0f", value);
     }
     else
     {
         // Use higher precision to minimize round-trip loss
         // %.15g provides enough precision for double while avoiding
         // unnecessary trailing digits
-        return fprintf(out, "%.15g", node->value.number);
+        return fprintf(out, "%.15g", value);
     }
 }
 
+int json_write_number(struct json *node, FILE *out)
+{
+    if (!node || !out)
+        return -1;
+
+    // Lazily read numbers are written back exactly as they were read
+    if (node->raw)
+        return fputs(node->raw, out) < 0 ? -1 : (int)strlen(node->raw);
+
+    return json_write_double(node->value.number, out);
+}
+
+// Inline numbers are written without being turned into nodes
+int json_write_cell(json_cell cell, FILE *out)
+{
+    if (json_cell_is_node(cell))
+        return json_write(json_cell_node(cell), out);
+    return json_write_double(json_cell_number(cell), out);
+}
+
 int json_write_string(struct json *node, FILE *out)
 {
     if (!node || !out)
         return -1;
 
-    return json_write_escaped_string(node->value.string, out);
+    // Lazily read strings are still escaped as they were in the source
+    const char *raw = json_raw(node);
+    if (raw)
+    {
+        if (fputc('"', out) == EOF || fputs(raw, out) < 0 || fputc('"', out) == EOF)
+            return -1;
+        return (int)strlen(raw) + 2;
+    }
+
+    return json_write_escaped_string(json_string_data(node), out);
 }
 
 int json_write_array(struct json *node, FILE *out)
@@ -128,37 +167,25 @@ int json_write_array(struct json *node, FILE *out)
         return -1;
 
     int ret, bytes_written = 0;
-    struct linked_list_json_iter *iter = linked_list_json_iter_new(node->value.array);
-    if (!iter)
-    {
-        return -1;
-    }
+    int length = vector_json_length(node->value.array);
     ret = fprintf(out, "[");
     if (ret < 0)
         return ret;
     bytes_written += ret;
-    struct json *element;
-    while ((element = linked_list_json_iter_next(iter)))
+    for (int i = 0; i < length; i++)
     {
-        int ret = json_write(element, out);
+        int ret = json_write_cell(json_cell_load(vector_json_get(node->value.array, i)), out);
         if (ret < 0)
-        {
-            linked_list_json_iter_free(iter);
             return ret;
-        }
         bytes_written += ret;
-        if (linked_list_json_iter_has_next(iter))
+        if (i < length - 1)
         {
             ret = fprintf(out, ",");
             if (ret < 0)
-            {
-                linked_list_json_iter_free(iter);
                 return ret;
-            }
             bytes_written += ret;
         }
     }
-    linked_list_json_iter_free(iter);
     ret = fprintf(out, "]");
     if (ret < 0)
         return ret;
@@ -172,55 +199,38 @@ int json_write_object(struct json *node, FILE *out)
         return -1;
 
     int ret, bytes_written = 0;
-    struct hash_table_iter *iter = hash_table_iter_new(node->value.object);
-    if (!iter)
-    {
-        return -1;
-    }
     ret = fprintf(out, "{");
     if (ret < 0)
         return ret;
     bytes_written += ret;
+    size_t position = 0;
     struct hash_table_entry *entry;
-    while ((entry = hash_table_iter_next(iter)))
+    for (int first = 1; (entry = hash_table_next(node->value.object, &position)); first = 0)
     {
+        if (!first)
+        {
+            ret = fprintf(out, ",");
+            if (ret < 0)
+                return ret;
+            bytes_written += ret;
+        }
+
         // Properly escape the object key
-        ret = json_write_escaped_string(hash_table_entry_key(entry), out);
+        ret = json_write_escaped_bytes(hash_table_entry_key(entry), hash_table_entry_key_length(entry), out);
         if (ret < 0)
-        {
-            hash_table_iter_free(iter);
             return ret;
-        }
         bytes_written += ret;
 
         ret = fprintf(out, ":");
         if (ret < 0)
-        {
-            hash_table_iter_free(iter);
             return ret;
-        }
         bytes_written += ret;
 
-        ret = json_write(hash_table_entry_value(entry), out);
+        ret = json_write_cell(json_cell_load(hash_table_entry_value(entry)), out);
         if (ret < 0)
-        {
-            hash_table_iter_free(iter);
             return ret;
-        }
         bytes_written += ret;
-
-        if (hash_table_iter_has_next(iter))
-        {
-            ret = fprintf(out, ",");
-            if (ret < 0)
-            {
-                hash_table_iter_free(iter);
-                return ret;
-            }
-            bytes_written += ret;
-        }
     }
-    hash_table_iter_free(iter);
     ret = fprintf(out, "}");
     if (ret < 0)
         return ret;
@@ -0,0 +1,220 @@
+#include "json_internal.h"
+
+#include <stdlib.h>
+#include <pthread.h>
+
+/**
+ * @section Slab allocator for small fixed-size structures
+ *
+ * Nodes, vectors, tables, closures and list nodes are carved out of large
+ * chunks, by size classes of 8 bytes. Each thread keeps its own free list per
+ * class, so allocating and freeing never take a lock. Objects may be freed by
+ * another thread than the one that allocated them, and join the free list of
+ * the freeing thread. A free list that grows past LIBJSON_SLAB_CACHE_MAX
+ * objects hands half of them over to a shared pool, from which the threads
+ * that allocate refill their caches before carving new chunks, so a thread
+ * freeing what another one allocates does not keep memory from it. When a
+ * thread exits, its free objects are handed over to the other threads.
+ * Chunks are kept for the lifetime of the process.
+ */
+
+#define LIBJSON_SLAB_GRANULARITY 8
+#define LIBJSON_SLAB_MAX_SIZE 128
+#define LIBJSON_SLAB_CLASSES (LIBJSON_SLAB_MAX_SIZE / LIBJSON_SLAB_GRANULARITY)
+#define LIBJSON_SLAB_CHUNK_SIZE 65536
+// Free objects a thread keeps per class, and moves to or from the shared pool
+// at once
+#define LIBJSON_SLAB_CACHE_MAX 1024
+#define LIBJSON_SLAB_BATCH (LIBJSON_SLAB_CACHE_MAX / 2)
+
+struct slab_object
+{
+    struct slab_object *next;
+};
+
+struct slab_chunk
+{
+    struct slab_chunk *next;
+};
+
+struct slab_cache
+{
+    struct slab_object *free; // objects ready for reuse
+    size_t count;             // length of the free list
+    char *bump;               // unused part of the current chunk
+    char *end;
+};
+
+static __thread struct slab_cache slab_caches[LIBJSON_SLAB_CLASSES];
+static __thread int slab_thread_registered;
+
+// Shared by all threads, under the lock: every chunk, and the free objects
+// handed over by the threads that exited or freed too many
+static pthread_mutex_t slab_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct slab_chunk *slab_chunks;
+static struct slab_object *slab_orphans[LIBJSON_SLAB_CLASSES];
+static pthread_once_t slab_once = PTHREAD_ONCE_INIT;
+static pthread_key_t slab_key;
+
+static size_t slab_class(size_t size)
+{
+    return size ? (size - 1) / LIBJSON_SLAB_GRANULARITY : 0;
+}
+
+// Hands over the free objects of an exiting thread, including the unused
+// part of its chunks
+static void slab_thread_exit(void *unused)
+{
+    (void)unused;
+    pthread_mutex_lock(&slab_lock);
+    for (size_t i = 0; i < LIBJSON_SLAB_CLASSES; i++)
+    {
+        struct slab_cache *cache = &slab_caches[i];
+        size_t object_size = (i + 1) * LIBJSON_SLAB_GRANULARITY;
+        while (cache->bump && cache->bump + object_size <= cache->end)
+        {
+            struct slab_object *object = (struct slab_object *)cache->bump;
+            object->next = cache->free;
+            cache->free = object;
+            cache->bump += object_size;
+        }
+        while (cache->free)
+        {
+            struct slab_object *object = cache->free;
+            cache->free = object->next;
+            object->next = slab_orphans[i];
+            slab_orphans[i] = object;
+        }
+        cache->count = 0;
+        cache->bump = cache->end = NULL;
+    }
+    pthread_mutex_unlock(&slab_lock);
+}
+
+static void slab_init(void)
+{
+    pthread_key_create(&slab_key, slab_thread_exit);
+}
+
+// Makes sure that the free objects of the calling thread are handed over
+// when it exits
+static void slab_register_thread(void)
+{
+    if (slab_thread_registered)
+        return;
+    // The key only has a destructor call for threads where it is set
+    pthread_once(&slab_once, slab_init);
+    pthread_setspecific(slab_key, slab_caches);
+    slab_thread_registered = 1;
+}
+
+// Hands a batch of the free objects of a cache over to the shared pool
+static void slab_spill(struct slab_cache *cache, size_t class)
+{
+    struct slab_object *first = cache->free;
+    struct slab_object *last = first;
+    for (size_t i = 1; i < LIBJSON_SLAB_BATCH; i++)
+        last = last->next;
+    cache->free = last->next;
+    cache->count -= LIBJSON_SLAB_BATCH;
+
+    pthread_mutex_lock(&slab_lock);
+    last->next = slab_orphans[class];
+    slab_orphans[class] = first;
+    pthread_mutex_unlock(&slab_lock);
+}
+
+// Refills the cache of a class, either with up to a batch of the objects
+// handed over by other threads or with a new chunk
+static int slab_refill(struct slab_cache *cache, size_t class)
+{
+    slab_register_thread();
+    pthread_mutex_lock(&slab_lock);
+    if (slab_orphans[class])
+    {
+        struct slab_object *last = slab_orphans[class];
+        size_t count = 1;
+        while (last->next && count < LIBJSON_SLAB_BATCH)
+        {
+            last = last->next;
+            count++;
+        }
+        cache->free = slab_orphans[class];
+        cache->count = count;
+        slab_orphans[class] = last->next;
+        last->next = NULL;
+        pthread_mutex_unlock(&slab_lock);
+        return 1;
+    }
+    struct slab_chunk *chunk = json_mem_alloc(LIBJSON_SLAB_CHUNK_SIZE);
+    if (chunk)
+    {
+        chunk->next = slab_chunks;
+        slab_chunks = chunk;
+    }
+    pthread_mutex_unlock(&slab_lock);
+    if (!chunk)
+        return 0;
+
+    // The chunk header takes the room of one 16-byte aligned slot
+    cache->bump = (char *)chunk + 16;
+    cache->end = (char *)chunk + LIBJSON_SLAB_CHUNK_SIZE;
+    return 1;
+}
+
+void *slab_alloc(size_t size)
+{
+#ifdef LIBJSON_NO_SLAB
+    return json_mem_alloc(size);
+#else
+    if (size > LIBJSON_SLAB_MAX_SIZE)
+        return json_mem_alloc(size);
+
+    size_t class = slab_class(size);
+    size_t object_size = (class + 1) * LIBJSON_SLAB_GRANULARITY;
+    struct slab_cache *cache = &slab_caches[class];
+    for (;;)
+    {
+        if (cache->free)
+        {
+            struct slab_object *object = cache->free;
+            cache->free = object->next;
+            cache->count--;
+            return object;
+        }
+        if (cache->bump && cache->bump + object_size <= cache->end)
+        {
+            void *object = cache->bump;
+            cache->bump += object_size;
+            return object;
+        }
+        if (!slab_refill(cache, class))
+            return NULL;
+    }
+#endif
+}
+
+void slab_free(void *ptr, size_t size)
+{
+#ifdef LIBJSON_NO_SLAB
+    (void)size;
+    json_mem_free(ptr);
+#else
+    if (!ptr)
+        return;
+    if (size > LIBJSON_SLAB_MAX_SIZE)
+    {
+        json_mem_free(ptr);
+        return;
+    }
+
+    slab_register_thread();
+    size_t class = slab_class(size);
+    struct slab_cache *cache = &slab_caches[class];
+    struct slab_object *object = ptr;
+    object->next = cache->free;
+    cache->free = object;
+    if (++cache->count > LIBJSON_SLAB_CACHE_MAX)
+        slab_spill(cache, class);
+#endif
+}
@@ -0,0 +1,65 @@
+#include "json_internal.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define LIBJSON_STRING_BUFFER_INITIAL_CAPACITY 16
+
+void string_buffer_init(struct string_buffer *buffer)
+{
+    buffer->data = NULL;
+    buffer->length = 0;
+    buffer->capacity = 0;
+}
+
+static int string_buffer_reserve(struct string_buffer *buffer, size_t extra)
+{
+    // Always keep room for the terminating NUL
+    size_t needed = buffer->length + extra + 1;
+    if (needed <= buffer->capacity)
+        return 1;
+
+    size_t capacity = buffer->capacity ? buffer->capacity : LIBJSON_STRING_BUFFER_INITIAL_CAPACITY;
+    while (capacity < needed)
+        capacity *= 2;
+
+    char *data = json_mem_realloc(buffer->data, capacity);
+    if (!data)
+        return 0;
+    buffer->data = data;
+    buffer->capacity = capacity;
+    return 1;
+}
+
+int string_buffer_push(struct string_buffer *buffer, char c)
+{
+    if (!string_buffer_reserve(buffer, 1))
+        return 0;
+    buffer->data[buffer->length++] = c;
+    return 1;
+}
+
+int string_buffer_append(struct string_buffer *buffer, const char *data, size_t length)
+{
+    if (!string_buffer_reserve(buffer, length))
+        return 0;
+    memcpy(buffer->data + buffer->length, data, length);
+    buffer->length += length;
+    return 1;
+}
+
+char *string_buffer_take(struct string_buffer *buffer)
+{
+    if (!string_buffer_reserve(buffer, 0))
+        return NULL;
+    char *data = buffer->data;
+    data[buffer->length] = '\0';
+    string_buffer_init(buffer);
+    return data;
+}
+
+void string_buffer_free(struct string_buffer *buffer)
+{
+    json_mem_free(buffer->data);
+    string_buffer_init(buffer);
+}
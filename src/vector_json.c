@@ -0,0 +1,145 @@
+#include "json_internal.h"
+
+#include <stdlib.h>
+
+#define LIBJSON_VECTOR_INITIAL_CAPACITY 4
+
+/**
+ * Contiguous growable array of cells, used to store JSON arrays
+ */
+struct vector_json
+{
+    json_cell *items;
+    int length;
+    int capacity;
+    unsigned refs;            // arrays sharing the vector, see vector_json_share()
+    unsigned char deep;       // has held cells that cannot be shared, see vector_json_deep()
+    struct json_arena *arena; // holds the vector and its items, unless NULL
+};
+
+struct vector_json *vector_json_new(struct json_arena *arena)
+{
+    struct vector_json *vector = arena ? json_arena_alloc(arena, sizeof(struct vector_json)) : slab_alloc(sizeof(struct vector_json));
+    if (!vector)
+        return NULL;
+
+    vector->items = NULL;
+    vector->length = 0;
+    vector->capacity = 0;
+    vector->refs = 1;
+    vector->deep = 0;
+    vector->arena = arena;
+    return vector;
+}
+
+struct json_arena *vector_json_arena(const struct vector_json *vector)
+{
+    return vector ? vector->arena : NULL;
+}
+
+int vector_json_length(const struct vector_json *vector)
+{
+    return vector ? vector->length : 0;
+}
+
+void vector_json_free(struct vector_json *vector)
+{
+    if (!vector || vector->arena)
+        return;
+    // Note: We don't free the cells here - that's the caller's responsibility
+    json_mem_free(vector->items);
+    slab_free(vector, sizeof(struct vector_json));
+}
+
+// Vectors of copied arrays are shared until one of them is modified, which
+// then gets a clone of its own. Vectors of an arena are never shared.
+struct vector_json *vector_json_share(struct vector_json *vector)
+{
+    if (vector)
+        json_refs_retain(&vector->refs);
+    return vector;
+}
+
+// Drops a reference, and returns 1 if it was the last one, in which case the
+// caller frees the cells and the vector
+int vector_json_release(struct vector_json *vector)
+{
+    return vector && json_refs_release(&vector->refs);
+}
+
+int vector_json_shared(const struct vector_json *vector)
+{
+    return vector && json_refs_shared(&vector->refs);
+}
+
+// Vectors that have held arrays, objects or other cells that copies cannot
+// share, see json_cell_shareable(), are cloned by copies instead of shared
+int vector_json_deep(const struct vector_json *vector)
+{
+    return vector && vector->deep;
+}
+
+// Returns a vector of the heap with copies of the cells of the given one
+struct vector_json *vector_json_clone(const struct vector_json *vector, int (*copy_value)(json_cell, json_cell *), void (*free_value)(json_cell))
+{
+    struct vector_json *clone = vector_json_new(NULL);
+    if (!clone || !vector || !vector->length)
+        return clone;
+    if (!vector_json_reserve(clone, vector->length))
+    {
+        vector_json_free(clone);
+        return NULL;
+    }
+    for (int i = 0; i < vector->length; i++)
+    {
+        if (!copy_value(json_cell_load(&vector->items[i]), &clone->items[i]))
+        {
+            while (i-- > 0)
+                free_value(clone->items[i]);
+            vector_json_free(clone);
+            return NULL;
+        }
+    }
+    clone->length = vector->length;
+    clone->deep = vector->deep;
+    return clone;
+}
+
+int vector_json_reserve(struct vector_json *vector, int capacity)
+{
+    if (capacity <= vector->capacity)
+        return 1;
+
+    // Doubling keeps pushes amortized O(1)
+    int new_capacity = vector->capacity ? vector->capacity : LIBJSON_VECTOR_INITIAL_CAPACITY;
+    while (new_capacity < capacity)
+        new_capacity *= 2;
+
+    json_cell *items;
+    if (vector->arena)
+        items = json_arena_realloc(vector->arena, vector->items, vector->capacity * sizeof(json_cell), new_capacity * sizeof(json_cell));
+    else
+        items = json_mem_realloc(vector->items, new_capacity * sizeof(json_cell));
+    if (!items)
+        return 0;
+    vector->items = items;
+    vector->capacity = new_capacity;
+    return 1;
+}
+
+int vector_json_push(struct vector_json *vector, json_cell value)
+{
+    if (!vector_json_reserve(vector, vector->length + 1))
+        return 0;
+    if (!json_cell_shareable(value))
+        vector->deep = 1;
+    vector->items[vector->length++] = value;
+    return 1;
+}
+
+json_cell *vector_json_get(const struct vector_json *vector, int index)
+{
+    if (!vector || index < 0 || index >= vector->length)
+        return NULL;
+    return &vector->items[index];
+}
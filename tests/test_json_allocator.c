@@ -0,0 +1,97 @@
+#include "libjson/json.h"
+#include "libjson/json_arena.h"
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Counting allocator that tags its blocks, so that memory released through
+// the wrong allocator is caught
+#define MAGIC 0x6a736f6eUL
+#define HEADER 16
+
+struct counters
+{
+    long allocations;
+    long live;
+};
+
+static void *counting_malloc(size_t size, void *ctx)
+{
+    struct counters *counters = ctx;
+    unsigned long *block = malloc(size + HEADER);
+    if (!block)
+        return NULL;
+    block[0] = MAGIC;
+    counters->allocations++;
+    counters->live++;
+    return (char *)block + HEADER;
+}
+
+static void counting_free(void *ptr, void *ctx)
+{
+    struct counters *counters = ctx;
+    unsigned long *block = (unsigned long *)((char *)ptr - HEADER);
+    assert(block[0] == MAGIC);
+    block[0] = 0;
+    counters->live--;
+    free(block);
+}
+
+static void *counting_realloc(void *ptr, size_t size, void *ctx)
+{
+    if (!ptr)
+        return counting_malloc(size, ctx);
+    unsigned long *block = (unsigned long *)((char *)ptr - HEADER);
+    assert(block[0] == MAGIC);
+    block = realloc(block, size + HEADER);
+    return block ? (char *)block + HEADER : NULL;
+}
+
+int main()
+{
+    struct counters counters = {0, 0};
+    json_set_allocator(counting_malloc, counting_realloc, counting_free, &counters);
+
+    const char *text = "{\"name\": \"a string long enough for the heap\", \"esc\": \"a\\nb\", \"list\": [1, 2.5, true, {\"k\": [\"v\"]}]}";
+    char errbuf[1024];
+    struct json *value = json_read_string(text, errbuf);
+    assert(value != NULL);
+    assert(counters.allocations > 0);
+
+    struct json *copy = json_copy(value);
+    json_object_set(copy, "added", json_string("another long string value"));
+    json_free(json_object_remove(copy, "esc"));
+
+    // Strings handed to the caller come from the allocator too
+    char *name = (char *)json_string_value(json_object_get(copy, "name"));
+    assert(strcmp(name, "a string long enough for the heap") == 0);
+    counting_free(name, &counters);
+
+    struct json_read_options options = {.lazy_numbers = 1, .lazy_strings = 1};
+    struct json *lazy = json_read_string_opts(text, &options, errbuf);
+    assert(strcmp(json_string_borrow(json_object_get(lazy, "esc")), "a\nb") == 0);
+    json_free(lazy);
+
+    assert(json_read_string("[1, 2", errbuf) == NULL);
+    char *error = (char *)json_error(errbuf);
+    counting_free(error, &counters);
+
+    json_free(copy);
+    json_free(value);
+
+    // An arena can draw from an allocator of its own
+    struct counters arena_counters = {0, 0};
+    struct json_arena *arena = json_arena_new_allocator(4096, 0, counting_malloc, counting_free, &arena_counters);
+    options.arena = arena;
+    struct json *request = json_read_string_opts(text, &options, errbuf);
+    assert(request != NULL);
+    assert(arena_counters.allocations >= 2);
+    json_arena_free(arena);
+    assert(arena_counters.live == 0);
+
+    json_set_allocator(NULL, NULL, NULL, NULL);
+    struct json *plain = json_array(json_number(1));
+    json_free(plain);
+    return 0;
+}
@@ -0,0 +1,155 @@
+#include "libjson/json.h"
+#include "libjson/json_arena.h"
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+static char *serialize(struct json *value)
+{
+    char *data = NULL;
+    size_t size = 0;
+    FILE *out = open_memstream(&data, &size);
+    json_write(value, out);
+    fclose(out);
+    return data;
+}
+
+// Blocks handed out to an arena, to measure the memory it keeps
+static struct
+{
+    void *ptr;
+    size_t size;
+} blocks[64];
+
+static void *tracking_malloc(size_t size, void *ctx)
+{
+    (void)ctx;
+    void *ptr = malloc(size);
+    for (size_t i = 0; ptr && i < sizeof(blocks) / sizeof(blocks[0]); i++)
+    {
+        if (!blocks[i].ptr)
+        {
+            blocks[i].ptr = ptr;
+            blocks[i].size = size;
+            return ptr;
+        }
+    }
+    assert(!"too many blocks");
+    return NULL;
+}
+
+static void tracking_free(void *ptr, void *ctx)
+{
+    (void)ctx;
+    for (size_t i = 0; i < sizeof(blocks) / sizeof(blocks[0]); i++)
+    {
+        if (blocks[i].ptr == ptr)
+            blocks[i].ptr = NULL;
+    }
+    free(ptr);
+}
+
+static size_t tracked_size(void)
+{
+    size_t size = 0;
+    for (size_t i = 0; i < sizeof(blocks) / sizeof(blocks[0]); i++)
+    {
+        if (blocks[i].ptr)
+            size += blocks[i].size;
+    }
+    return size;
+}
+
+static const char *text = "{\"id\":7,\"name\":\"a name longer than a node\",\"esc\":\"tab\\there\",\"list\":[1,2.5,null,true,\"x\",{\"k\":[]}]}";
+
+static void check_parse(struct json_arena *arena, int lazy)
+{
+    struct json_read_options options = {.lazy_numbers = lazy, .lazy_strings = lazy, .arena = arena};
+    char errbuf[1024];
+    struct json *value = json_read_string_opts(text, &options, errbuf);
+    assert(json_error(errbuf) == NULL);
+    assert(json_int_value(json_object_get(value, "id")) == 7);
+    assert(strcmp(json_string_borrow(json_object_get(value, "esc")), "tab\there") == 0);
+    char *written = serialize(value);
+    assert(strcmp(written, text) == 0);
+    free(written);
+
+    // Freeing is left to the arena
+    json_free(json_array_get(json_object_get(value, "list"), 1));
+    json_free(value);
+}
+
+int main()
+{
+    struct json_arena *arena = json_arena_new(4096, 0);
+    assert(arena != NULL);
+    check_parse(arena, 0);
+    check_parse(arena, 1);
+
+    // Built values, including containers growing past a chunk
+    struct json *root = json_arena_object(arena);
+    struct json *list = json_arena_array(arena);
+    json_object_set(root, "list", list);
+    for (int i = 0; i < 2000; i++)
+        json_array_push(list, json_arena_number(arena, i));
+    for (int i = 0; i < 100; i++)
+    {
+        char key[32];
+        sprintf(key, "key%d", i);
+        json_object_set(root, key, json_arena_string(arena, key));
+    }
+    assert(json_array_length(list) == 2000);
+    assert(json_int_value(json_array_get(list, 1999)) == 1999);
+    assert(strcmp(json_string_borrow(json_object_get(root, "key99")), "key99") == 0);
+    assert(json_object_length(root) == 101);
+
+    // Strings larger than a chunk
+    char big[10000];
+    memset(big, 'a', sizeof(big) - 1);
+    big[sizeof(big) - 1] = '\0';
+    json_object_set(root, "big", json_arena_string(arena, big));
+    assert(strlen(json_string_borrow(json_object_get(root, "big"))) == sizeof(big) - 1);
+
+    // Copies outlive the arena
+    struct json *copy = json_copy(root);
+    json_arena_reset(arena);
+    assert(json_array_length(json_object_get(copy, "list")) == 2000);
+    assert(strcmp(json_string_borrow(json_object_get(copy, "key42")), "key42") == 0);
+    json_free(copy);
+
+    // The arena is usable again after a reset
+    check_parse(arena, 0);
+    json_arena_free(arena);
+
+    // Huge pages are only a hint
+    arena = json_arena_new(0, JSON_ARENA_HUGE_PAGES);
+    assert(arena != NULL);
+    check_parse(arena, 1);
+    json_arena_free(arena);
+
+    // Resetting keeps a chunk of regular size, not the one of an oversized
+    // allocation linked after it
+    arena = json_arena_new_allocator(4096, 0, tracking_malloc, tracking_free, NULL);
+    assert(arena != NULL);
+    size_t empty = tracked_size();
+    assert(json_arena_string(arena, big) != NULL);
+    json_arena_reset(arena);
+    assert(tracked_size() == empty + 4096);
+    check_parse(arena, 0);
+    assert(json_arena_string(arena, big) != NULL);
+    json_arena_reset(arena);
+    assert(tracked_size() == empty + 4096);
+    check_parse(arena, 1);
+    json_arena_free(arena);
+    assert(tracked_size() == 0);
+
+    // Chunks smaller than their header are rounded up
+    arena = json_arena_new(16, 0);
+    assert(arena != NULL);
+    check_parse(arena, 0);
+    json_arena_free(arena);
+
+    assert(json_arena_array(NULL) == NULL);
+    return 0;
+}
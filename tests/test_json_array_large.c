@@ -0,0 +1,41 @@
+#include "libjson/json.h"
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+int main()
+{
+    const int count = 1000000;
+
+    // Pushing stays cheap however long the array gets
+    struct json *array = json_array();
+    for (int i = 0; i < count; i++)
+        json_array_push(array, json_number(i));
+    assert(json_array_length(array) == count);
+    assert(json_int_value(json_array_get(array, 0)) == 0);
+    assert(json_int_value(json_array_get(array, count / 2)) == count / 2);
+    assert(json_int_value(json_array_get(array, count - 1)) == count - 1);
+    assert(json_array_get(array, count) == NULL);
+    assert(json_array_get(array, -1) == NULL);
+
+    // Round trip through the parser
+    char *text = NULL;
+    size_t size = 0;
+    FILE *out = open_memstream(&text, &size);
+    json_write(array, out);
+    fclose(out);
+    struct json *parsed = json_read_string(text, NULL);
+    assert(json_array_length(parsed) == count);
+    assert(json_int_value(json_array_get(parsed, count - 1)) == count - 1);
+
+    struct json *copy = json_copy(parsed);
+    assert(json_array_length(copy) == count);
+    assert(json_int_value(json_array_get(copy, 12345)) == 12345);
+
+    free(text);
+    json_free(copy);
+    json_free(parsed);
+    json_free(array);
+    return 0;
+}
@@ -0,0 +1,152 @@
+#include "libjson/json.h"
+#include "libjson/json_compress.h"
+#include <stdio.h>
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static void write_document(FILE *out, int count)
+{
+    fputc('[', out);
+    for (int i = 0; i < count; i++)
+        fprintf(out, "%s{\"id\": %d, \"name\": \"item%d\"}", i ? ", " : "", i, i);
+    fputc(']', out);
+}
+
+static void check_document(FILE *in, int count)
+{
+    char errbuf[1024];
+    struct json *value = json_read(in, errbuf);
+    assert(json_error(errbuf) == NULL);
+    assert(json_array_length(value) == count);
+    assert(json_int_value(json_object_get(json_array_get(value, count - 1), "id")) == count - 1);
+    json_free(value);
+}
+
+static void round_trip(const char *path, enum json_compression compression, int count)
+{
+    FILE *out = json_compressed_fopen(path, "w", compression);
+    assert(out != NULL);
+    write_document(out, count);
+    assert(fclose(out) == 0);
+
+    // The format is detected from the data
+    FILE *in = json_compressed_fopen(path, "r", JSON_COMPRESSION_AUTO);
+    assert(in != NULL);
+    check_document(in, count);
+    assert(fclose(in) == 0);
+    remove(path);
+}
+
+#ifdef LIBJSON_HAVE_ZSTD
+static void check_zstd(const char *path, int count)
+{
+    round_trip(path, JSON_COMPRESSION_ZSTD, count);
+
+    // Concatenated frames, whose last block ends past a block of the stream,
+    // so that the decoder still holds data once it was given all of the input
+    FILE *raw = fopen(path, "wb");
+    assert(raw != NULL);
+    FILE *out = json_compressed_wrap(raw, "w", JSON_COMPRESSION_ZSTD);
+    fputs("[\"same\"", out);
+    for (int i = 1; i < count / 4; i++)
+        fputs(", \"same\"", out);
+    assert(fclose(out) == 0);
+    raw = fopen(path, "ab");
+    out = json_compressed_wrap(raw, "w", JSON_COMPRESSION_ZSTD);
+    for (int i = count / 4; i < count; i++)
+        fputs(", \"same\"", out);
+    fputc(']', out);
+    assert(fclose(out) == 0);
+    char errbuf[1024];
+    FILE *in = json_compressed_fopen(path, "r", JSON_COMPRESSION_AUTO);
+    assert(in != NULL);
+    struct json *value = json_read(in, errbuf);
+    assert(json_error(errbuf) == NULL);
+    assert(json_array_length(value) == count);
+    json_free(value);
+    assert(fclose(in) == 0);
+
+    // Truncated data is an error, not the end of the stream
+    out = json_compressed_fopen(path, "w", JSON_COMPRESSION_ZSTD);
+    write_document(out, count);
+    fclose(out);
+    assert(truncate(path, 1000) == 0);
+    in = json_compressed_fopen(path, "r", JSON_COMPRESSION_AUTO);
+    assert(in != NULL);
+    value = json_read(in, errbuf);
+    assert(value == NULL);
+    assert(ferror(in));
+    fclose(in);
+    remove(path);
+}
+#endif
+
+int main()
+{
+    char path[] = "/tmp/libjson_compressedXXXXXX";
+    char gz_path[64];
+    const int count = 50000;
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    close(fd);
+
+    // Plain files pass through
+    assert(json_compression_supported(JSON_COMPRESSION_NONE));
+    round_trip(path, JSON_COMPRESSION_NONE, 100);
+
+    if (json_compression_supported(JSON_COMPRESSION_GZIP))
+    {
+        // The extension selects the format when writing
+        sprintf(gz_path, "%s.gz", path);
+        round_trip(gz_path, JSON_COMPRESSION_AUTO, count);
+
+        // Concatenated members read as one stream
+        FILE *raw = fopen(path, "wb");
+        assert(raw != NULL);
+        FILE *out = json_compressed_wrap(raw, "w", JSON_COMPRESSION_GZIP);
+        fputs("[1, 2, ", out);
+        assert(fclose(out) == 0);
+        raw = fopen(path, "ab");
+        out = json_compressed_wrap(raw, "w", JSON_COMPRESSION_GZIP);
+        fputs("3]", out);
+        assert(fclose(out) == 0);
+
+        char errbuf[1024];
+        FILE *in = json_compressed_fopen(path, "r", JSON_COMPRESSION_GZIP);
+        assert(in != NULL);
+        struct json *value = json_read(in, errbuf);
+        assert(json_error(errbuf) == NULL);
+        assert(json_array_length(value) == 3);
+        assert(json_int_value(json_array_get(value, 2)) == 3);
+        json_free(value);
+        fclose(in);
+
+        // Truncated data is an error
+        out = json_compressed_fopen(path, "w", JSON_COMPRESSION_GZIP);
+        write_document(out, count);
+        fclose(out);
+        assert(truncate(path, 1000) == 0);
+        in = json_compressed_fopen(path, "r", JSON_COMPRESSION_AUTO);
+        assert(in != NULL);
+        value = json_read(in, errbuf);
+        assert(json_error(errbuf) != NULL);
+        assert(ferror(in));
+        fclose(in);
+    }
+    else
+    {
+        assert(json_compressed_fopen(path, "r", JSON_COMPRESSION_GZIP) == NULL);
+        assert(errno == ENOTSUP);
+    }
+
+#ifdef LIBJSON_HAVE_ZSTD
+    assert(json_compression_supported(JSON_COMPRESSION_ZSTD));
+    check_zstd(path, count);
+#endif
+
+    remove(path);
+    return 0;
+}
@@ -0,0 +1,142 @@
+#include "libjson/json.h"
+#include "libjson/json_document.h"
+#include <stdio.h>
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define THREADS 4
+
+static long allocations = 0;
+
+static void *counting_malloc(size_t size, void *ctx)
+{
+    (void)ctx;
+    __atomic_fetch_add(&allocations, 1, __ATOMIC_RELAXED);
+    return malloc(size);
+}
+
+static void *counting_realloc(void *ptr, size_t size, void *ctx)
+{
+    (void)ctx;
+    __atomic_fetch_add(&allocations, 1, __ATOMIC_RELAXED);
+    return realloc(ptr, size);
+}
+
+static void plain_free(void *ptr, void *ctx)
+{
+    (void)ctx;
+    free(ptr);
+}
+
+static const char *text = "{\"config\": {\"name\": \"a name long enough for the heap\", \"path\": \"C:\\\\tmp\", \"limits\": [1, 2, 3]}, \"list\": [{\"id\": 1}, {\"id\": 2}]}";
+
+// Each consumer modifies its copy of the same value
+static void *consumer(void *arg)
+{
+    struct json *copy = arg;
+    char name[32];
+    struct json *config = json_object_get(copy, "config");
+    assert(strcmp(json_string_borrow(json_object_get(config, "path")), "C:\\tmp") == 0);
+    json_array_push_number(json_object_get(config, "limits"), 4);
+    sprintf(name, "%p", arg);
+    json_object_set(config, "name", json_string(name));
+    assert(json_array_length(json_object_get(config, "limits")) == 4);
+    assert(strcmp(json_string_borrow(json_object_get(config, "name")), name) == 0);
+    json_free(copy);
+    return NULL;
+}
+
+int main()
+{
+    json_set_allocator(counting_malloc, counting_realloc, plain_free, NULL);
+    char errbuf[1024];
+    struct json_read_options options = {.lazy_strings = 1};
+    struct json *original = json_read_string_opts(text, &options, errbuf);
+    assert(original != NULL);
+
+    // Modifying a copy only affects the copy, at any depth
+    struct json *copy = json_copy(original);
+    struct json *limits = json_object_get(json_object_get(copy, "config"), "limits");
+    json_array_push_number(limits, 4);
+    json_free(json_object_remove(json_array_get(json_object_get(copy, "list"), 1), "id"));
+    assert(json_array_length(json_object_get(json_object_get(original, "config"), "limits")) == 3);
+    assert(json_int_value(json_object_get(json_array_get(json_object_get(original, "list"), 1), "id")) == 2);
+    assert(json_object_get(json_array_get(json_object_get(copy, "list"), 1), "id") == NULL);
+
+    // And the other way around
+    json_object_set_number(json_array_get(json_object_get(original, "list"), 0), "id", 10);
+    assert(json_int_value(json_object_get(json_array_get(json_object_get(copy, "list"), 0), "id")) == 1);
+
+    // Values obtained before copying are not shared with the copy either
+    struct json *config = json_object_get(original, "config");
+    struct json *path = json_object_get(config, "path");
+    struct json *before_copy = json_copy(original);
+    json_object_set(config, "path", json_string("D:"));
+    assert(strcmp(json_string_borrow(json_object_get(json_object_get(before_copy, "config"), "path")), "C:\\tmp") == 0);
+    json_free(json_object_get(config, "path"));
+    json_object_set(config, "path", path);
+    json_free(before_copy);
+
+    // Copies outlive the original
+    struct json *second = json_copy(copy);
+    json_free(copy);
+    assert(json_array_length(json_object_get(json_object_get(second, "config"), "limits")) == 4);
+    json_free(second);
+
+    // Copying a large array of scalars only allocates the node of the copy,
+    // and getting its values allocates nothing
+    struct json *large = json_array();
+    for (int i = 0; i < 1000; i++)
+        json_array_push(large, json_string("a string long enough for the heap"));
+    long before = allocations;
+    struct json *copies[100];
+    for (int i = 0; i < 100; i++)
+        copies[i] = json_copy(large);
+    for (int i = 0; i < 100; i++)
+        assert(json_array_get(copies[i], 999) == json_array_get(large, 999));
+    assert(allocations - before <= 100);
+    json_free(large);
+    for (int i = 0; i < 100; i++)
+    {
+        assert(json_array_length(copies[i]) == 1000);
+        json_free(copies[i]);
+    }
+
+    // Nested arrays and objects get a node each, but their strings are shared
+    struct json *nested = json_array();
+    for (int i = 0; i < 1000; i++)
+        json_array_push(nested, json_object((struct json_key_value){"value", json_string("a string long enough for the heap")}));
+    before = allocations;
+    struct json *nested_copy = json_copy(nested);
+    assert(allocations - before <= 1001 + 2);
+    assert(json_object_get(json_array_get(nested_copy, 0), "value") == json_object_get(json_array_get(nested, 0), "value"));
+    json_free(nested);
+    json_free(nested_copy);
+
+    // Copies handed to other threads
+    pthread_t threads[THREADS];
+    for (int i = 0; i < THREADS; i++)
+        assert(pthread_create(&threads[i], NULL, consumer, json_copy(original)) == 0);
+    for (int i = 0; i < THREADS; i++)
+        assert(pthread_join(threads[i], NULL) == 0);
+    config = json_object_get(original, "config");
+    assert(json_array_length(json_object_get(config, "limits")) == 3);
+    assert(strcmp(json_string_borrow(json_object_get(config, "name")), "a name long enough for the heap") == 0);
+    json_free(original);
+
+    // Values of a document are edited in place, so copies do not share them
+    char source[] = "{\"a\": [1, 2]}";
+    struct json_document *document = json_document_parse(source, strlen(source), JSON_SYNTAX_JSON, errbuf);
+    assert(document != NULL);
+    struct json *snapshot = json_copy(json_document_root(document));
+    source[7] = '7';
+    struct json_edit edit = {.offset = 7, .removed = 1, .inserted_length = 1};
+    assert(json_document_edit(document, &edit, source, strlen(source), errbuf));
+    assert(json_int_value(json_array_get(json_object_get(json_document_root(document), "a"), 0)) == 7);
+    assert(json_int_value(json_array_get(json_object_get(snapshot, "a"), 0)) == 1);
+    json_free(snapshot);
+    json_document_free(document);
+    return 0;
+}
@@ -0,0 +1,174 @@
+#include "libjson/json.h"
+#include "libjson/json5.h"
+#include "libjson/json_document.h"
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+static char text[4096];
+
+// Applies an edit to the text and the document
+static int edit(struct json_document *document, size_t offset, size_t removed, const char *inserted, char *errbuf)
+{
+    size_t length = strlen(text), inserted_length = strlen(inserted);
+    memmove(text + offset + inserted_length, text + offset + removed, length - offset - removed + 1);
+    memcpy(text + offset, inserted, inserted_length);
+    struct json_edit change = {offset, removed, inserted_length};
+    return json_document_edit(document, &change, text, strlen(text), errbuf);
+}
+
+static int edit_at(struct json_document *document, const char *anchor, size_t removed, const char *inserted, char *errbuf)
+{
+    char *found = strstr(text, anchor);
+    assert(found != NULL);
+    return edit(document, found - text, removed, inserted, errbuf);
+}
+
+static char *serialize(struct json *value)
+{
+    char *data = NULL;
+    size_t size = 0;
+    FILE *out = open_memstream(&data, &size);
+    json_write(value, out);
+    fclose(out);
+    return data;
+}
+
+// The document must hold the same value as a full parse of its text
+static void check_document(struct json_document *document, int json5)
+{
+    struct json *expected = json5 ? json5_read_string(text, NULL) : json_read_string(text, NULL);
+    char *expected_text = serialize(expected);
+    char *actual_text = serialize(json_document_root(document));
+    assert(strcmp(expected_text, actual_text) == 0);
+    free(expected_text);
+    free(actual_text);
+    json_free(expected);
+}
+
+int main()
+{
+    char errbuf[1024];
+
+    strcpy(text, "{\"name\": \"a\", \"list\": [1, 2, 3], \"nested\": {\"x\": true}}");
+    struct json_document *document = json_document_parse(text, strlen(text), JSON_SYNTAX_JSON, errbuf);
+    assert(document != NULL);
+    struct json *root = json_document_root(document);
+    struct json *list = json_object_get(root, "list");
+    struct json *first = json_array_get(list, 0);
+    struct json *nested = json_object_get(root, "nested");
+
+    // Editing a scalar only replaces that scalar
+    assert(edit_at(document, "2,", 1, "25", errbuf));
+    assert(json_error(errbuf) == NULL);
+    assert(json_document_root(document) == root);
+    assert(json_object_get(root, "list") == list);
+    assert(json_array_get(list, 0) == first);
+    assert(json_object_get(root, "nested") == nested);
+    assert(json_int_value(json_array_get(list, 1)) == 25);
+    check_document(document, 0);
+
+    // Adding an element re-parses the enclosing array in place
+    assert(edit_at(document, "]", 0, ", 4", errbuf));
+    assert(json_object_get(root, "list") == list);
+    assert(json_array_length(list) == 4);
+    assert(json_object_get(root, "nested") == nested);
+    check_document(document, 0);
+
+    // Spans after an edit are shifted
+    assert(edit_at(document, "\"a\"", 3, "\"longer name\"", errbuf));
+    assert(edit_at(document, "true", 4, "null", errbuf));
+    assert(json_is_null(json_object_get(nested, "x")));
+    assert(edit_at(document, "null", 4, "[false]", errbuf));
+    assert(json_object_get(root, "nested") == nested);
+    check_document(document, 0);
+
+    // Edits inside keys re-parse the object
+    assert(edit_at(document, "name", 4, "title", errbuf));
+    assert(json_object_get(root, "title") != NULL);
+    assert(json_document_root(document) == root);
+    check_document(document, 0);
+
+    // Invalid text drops the value until it is fixed
+    size_t length = strlen(text);
+    assert(!edit(document, length - 1, 1, "", errbuf));
+    assert(errbuf[0] != '\0');
+    assert(json_document_root(document) == NULL);
+    assert(edit(document, length - 1, 0, "}", errbuf));
+    check_document(document, 0);
+
+    // Edits that do not match the document are rejected
+    struct json_edit bad = {strlen(text) + 1, 0, 0};
+    assert(!json_document_edit(document, &bad, text, strlen(text), errbuf));
+
+    // Many edits in a row match a full parse
+    strcpy(text, "[");
+    for (int i = 0; i < 50; i++)
+        sprintf(text + strlen(text), "%s{\"id\": %d, \"tags\": [\"t%d\"]}", i ? ", " : "", i, i);
+    strcat(text, "]");
+    json_document_free(document);
+    document = json_document_parse(text, strlen(text), JSON_SYNTAX_JSON, errbuf);
+    assert(document != NULL);
+    srand(7);
+    for (int i = 0; i < 500; i++)
+    {
+        // Replace a random digit, possibly with something else
+        size_t offset = rand() % strlen(text);
+        while (!strchr("0123456789", text[offset]))
+            offset = (offset + 1) % strlen(text);
+        const char *replacements[] = {"7", "", "12", "true", " 3", "\"s\"", "[9]"};
+        int valid = edit(document, offset, 1, replacements[rand() % 7], errbuf);
+        if (valid)
+            check_document(document, 0);
+        else
+            assert(json_document_root(document) == NULL);
+    }
+    json_document_free(document);
+
+    // JSON5 documents keep their syntax
+    strcpy(text, "{a: 1, /* note */ b: ['x', 2,],}");
+    document = json_document_parse(text, strlen(text), JSON_SYNTAX_JSON5, errbuf);
+    assert(document != NULL);
+    root = json_document_root(document);
+    list = json_object_get(root, "b");
+    assert(edit_at(document, "2,", 1, "'y'", errbuf));
+    assert(json_object_get(root, "b") == list);
+    check_document(document, 1);
+    assert(edit_at(document, "1,", 0, "// c\n", errbuf));
+    check_document(document, 1);
+    json_document_free(document);
+
+    // Scalars edited into null, true or false are the shared singletons
+    strcpy(text, "[1, 2, 3]");
+    document = json_document_parse(text, strlen(text), JSON_SYNTAX_JSON, errbuf);
+    assert(document != NULL);
+    root = json_document_root(document);
+    assert(edit_at(document, "2", 1, "null", errbuf));
+    assert(json_document_root(document) == root);
+    assert(json_is_null(json_array_get(root, 1)));
+    assert(edit_at(document, "3", 1, "true", errbuf));
+    assert(json_array_get(root, 2) == json_true());
+    assert(edit_at(document, "1", 1, "false", errbuf));
+    assert(json_array_get(root, 0) == json_false());
+    assert(edit_at(document, "null", 4, "4", errbuf));
+    assert(json_int_value(json_array_get(root, 1)) == 4);
+    check_document(document, 0);
+    json_document_free(document);
+
+    // And so is a root scalar
+    strcpy(text, "5");
+    document = json_document_parse(text, strlen(text), JSON_SYNTAX_JSON, errbuf);
+    assert(document != NULL);
+    assert(edit(document, 0, 1, "null", errbuf));
+    assert(json_is_null(json_document_root(document)));
+    assert(edit(document, 0, 4, "true", errbuf));
+    assert(json_document_root(document) == json_true());
+    assert(edit(document, 0, 4, "6", errbuf));
+    assert(json_int_value(json_document_root(document)) == 6);
+    json_document_free(document);
+
+    assert(json_document_parse("[1,", 3, JSON_SYNTAX_JSON, errbuf) == NULL);
+    assert(errbuf[0] != '\0');
+    return 0;
+}
@@ -0,0 +1,112 @@
+#include "libjson/json.h"
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+static void write_all(int fd, const char *data, size_t length)
+{
+    while (length > 0)
+    {
+        ssize_t n = write(fd, data, length);
+        assert(n > 0);
+        data += n;
+        length -= n;
+    }
+}
+
+int main()
+{
+    char errbuf[1024];
+    struct json *value;
+    int fds[2];
+    assert(pipe(fds) == 0);
+    assert(fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK) == 0);
+
+    struct json_fd_reader *reader = json_fd_reader_new(fds[0], NULL);
+    assert(reader != NULL);
+
+    // Nothing to read yet
+    assert(json_fd_reader_next(reader, &value, errbuf) == JSON_READ_AGAIN);
+
+    // A value split across several reads resumes where it stopped
+    write_all(fds[1], "{\"name\": \"a}b\", \"list\": [1,", 27);
+    assert(json_fd_reader_next(reader, &value, errbuf) == JSON_READ_AGAIN);
+    write_all(fds[1], " 2]}\n42 ", 8);
+    assert(json_fd_reader_next(reader, &value, errbuf) == JSON_READ_VALUE);
+    assert(json_is_object(value));
+    assert(strcmp(json_string_borrow(json_object_get(value, "name")), "a}b") == 0);
+    assert(json_array_length(json_object_get(value, "list")) == 2);
+    assert(json_fd_reader_offset(reader) == 31);
+    json_free(value);
+
+    assert(json_fd_reader_next(reader, &value, errbuf) == JSON_READ_VALUE);
+    assert(json_int_value(value) == 42);
+    json_free(value);
+    assert(json_fd_reader_next(reader, &value, errbuf) == JSON_READ_AGAIN);
+
+    // Invalid values are reported and skipped
+    write_all(fds[1], "[1 2] \x1e\"ok\"", 11);
+    assert(json_fd_reader_next(reader, &value, errbuf) == JSON_READ_ERROR);
+    assert(errbuf[0] != '\0');
+    assert(json_fd_reader_next(reader, &value, errbuf) == JSON_READ_VALUE);
+    assert(strcmp(json_string_borrow(value), "ok") == 0);
+    json_free(value);
+
+    // Values wrapping around the end of the ring buffer
+    for (int batch = 0; batch < 20; batch++)
+    {
+        for (int i = 0; i < 500; i++)
+            write_all(fds[1], "{\"key\":12345} ", 14);
+        for (int i = 0; i < 500; i++)
+        {
+            assert(json_fd_reader_next(reader, &value, errbuf) == JSON_READ_VALUE);
+            assert(json_int_value(json_object_get(value, "key")) == 12345);
+            json_free(value);
+        }
+        assert(json_fd_reader_next(reader, &value, errbuf) == JSON_READ_AGAIN);
+    }
+
+    // Values larger than the ring buffer grow it
+    const int count = 20000;
+    write_all(fds[1], "[", 1);
+    for (int i = 0; i < count; i++)
+    {
+        char element[32];
+        int length = sprintf(element, "%s\"item%05d\"", i ? "," : "", i);
+        write_all(fds[1], element, length);
+        if (i % 1000 == 0)
+            assert(json_fd_reader_next(reader, &value, errbuf) == JSON_READ_AGAIN);
+    }
+    write_all(fds[1], "] 7", 3);
+    assert(json_fd_reader_next(reader, &value, errbuf) == JSON_READ_VALUE);
+    assert(json_array_length(value) == count);
+    assert(strcmp(json_string_borrow(json_array_get(value, count - 1)), "item19999") == 0);
+    json_free(value);
+
+    // The end of the stream delimits a trailing scalar
+    close(fds[1]);
+    assert(json_fd_reader_next(reader, &value, errbuf) == JSON_READ_VALUE);
+    assert(json_int_value(value) == 7);
+    json_free(value);
+    assert(json_fd_reader_next(reader, &value, errbuf) == JSON_READ_EOF);
+
+    json_fd_reader_free(reader);
+    close(fds[0]);
+
+    // Bytes of a value cut by the end of the stream are still consumed
+    assert(pipe(fds) == 0);
+    reader = json_fd_reader_new(fds[0], NULL);
+    write_all(fds[1], "1 {\"cut\": [", 12);
+    close(fds[1]);
+    assert(json_fd_reader_next(reader, &value, errbuf) == JSON_READ_VALUE);
+    json_free(value);
+    assert(json_fd_reader_next(reader, &value, errbuf) == JSON_READ_ERROR);
+    assert(json_fd_reader_offset(reader) == 12);
+    assert(json_fd_reader_next(reader, &value, errbuf) == JSON_READ_EOF);
+    json_fd_reader_free(reader);
+    close(fds[0]);
+    return 0;
+}
@@ -0,0 +1,112 @@
+#include "libjson/json.h"
+#include <stdio.h>
+#include <assert.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+static char *serialize(struct json *value)
+{
+    char *data = NULL;
+    size_t size = 0;
+    FILE *out = open_memstream(&data, &size);
+    json_write(value, out);
+    fclose(out);
+    return data;
+}
+
+#define THREADS 4
+
+// Reads numbers nobody has read yet, at the same time as the other threads
+static void *reader(void *arg)
+{
+    struct json *numbers = arg;
+    struct json **nodes = malloc(100 * sizeof(struct json *));
+    for (int i = 0; i < 100; i++)
+    {
+        nodes[i] = json_array_get(numbers, i);
+        assert(json_int_value(nodes[i]) == i);
+    }
+    return nodes;
+}
+
+int main()
+{
+    // Numbers pushed inline read back like any other element
+    struct json *array = json_array();
+    json_array_push_number(array, 1.5);
+    json_array_push_number(array, -0.0);
+    json_array_push_number(array, 1e308);
+    json_array_push_number(array, -INFINITY);
+    json_array_push(array, json_string("x"));
+    json_array_push_number(array, 42);
+    assert(json_array_length(array) == 6);
+    assert(json_double_value(json_array_get(array, 0)) == 1.5);
+    assert(signbit(json_double_value(json_array_get(array, 1))));
+    assert(json_double_value(json_array_get(array, 2)) == 1e308);
+    assert(json_double_value(json_array_get(array, 3)) == -INFINITY);
+    assert(json_is_string(json_array_get(array, 4)));
+
+    // The node of an accessed number stays the same
+    struct json *number = json_array_get(array, 5);
+    assert(json_is_number(number));
+    assert(json_array_get(array, 5) == number);
+    assert(json_int_value(number) == 42);
+
+    // Numbers can be read without getting their node
+    double read = 0;
+    assert(json_array_get_number(array, 0, &read) && read == 1.5);
+    assert(json_array_get_number(array, 5, &read) && read == 42);
+    assert(!json_array_get_number(array, 4, &read));
+    assert(!json_array_get_number(array, 6, &read));
+
+    // NaN is kept as a number, not mistaken for a node
+    json_array_push_number(array, NAN);
+    assert(isnan(json_double_value(json_array_get(array, 6))));
+    json_free(array);
+
+    // Threads boxing the same numbers all get the node kept by the array
+    struct json *numbers = json_array();
+    for (int i = 0; i < 100; i++)
+        json_array_push_number(numbers, i);
+    pthread_t threads[THREADS];
+    for (int i = 0; i < THREADS; i++)
+        assert(pthread_create(&threads[i], NULL, reader, numbers) == 0);
+    for (int i = 0; i < THREADS; i++)
+    {
+        struct json **nodes;
+        assert(pthread_join(threads[i], (void **)&nodes) == 0);
+        for (int j = 0; j < 100; j++)
+            assert(nodes[j] == json_array_get(numbers, j));
+        free(nodes);
+    }
+    json_free(numbers);
+
+    // Parsed containers write back the same text
+    const char *text = "{\"a\":1,\"b\":[2,3.25,null,true,false,\"s\",{\"c\":-4}],\"d\":0.5}";
+    struct json *value = json_read_string(text, NULL);
+    assert(value != NULL);
+    char *written = serialize(value);
+    assert(strcmp(written, text) == 0);
+    free(written);
+
+    // Copies hold their own nodes
+    struct json *copy = json_copy(value);
+    struct json *list = json_object_get(value, "b");
+    struct json *list_copy = json_object_get(copy, "b");
+    assert(json_array_get(list, 1) != json_array_get(list_copy, 1));
+    assert(json_double_value(json_array_get(list_copy, 1)) == 3.25);
+    json_free(copy);
+
+    // Removed numbers are handed over as nodes
+    struct json *removed = json_object_remove(value, "d");
+    assert(removed != NULL && json_double_value(removed) == 0.5);
+    json_free(removed);
+    assert(json_object_get(value, "d") == NULL);
+
+    json_object_set_number(value, "e", 7);
+    assert(json_int_value(json_object_get(value, "e")) == 7);
+    json_free(value);
+    return 0;
+}
@@ -0,0 +1,104 @@
+#include "libjson/json.h"
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+
+int main()
+{
+    char errbuf[1024];
+    struct json *array = json_read_string("[1, \"two\", [3], {\"four\": 4}, null]", errbuf);
+
+    struct json_array_iter iter;
+    int count = 0;
+    JSON_ARRAY_FOREACH(iter, array)
+    {
+        assert(iter.index == count);
+        assert(iter.value == json_array_get(array, count));
+        count++;
+    }
+    assert(count == 5);
+    assert(iter.value == NULL);
+
+    // Elements can be modified in place, without changing a copy
+    struct json *copy = json_copy(array);
+    JSON_ARRAY_FOREACH(iter, array)
+    {
+        if (json_is_array(iter.value))
+            json_array_push(iter.value, json_number(33));
+    }
+    assert(json_array_length(json_array_get(array, 2)) == 2);
+    assert(json_array_length(json_array_get(copy, 2)) == 1);
+    json_free(copy);
+
+    // Iterating over a copy only reads it, so it keeps sharing its values
+    struct json *flat = json_read_string("[\"a\", \"b\"]", errbuf);
+    struct json *flat_copy = json_copy(flat);
+    count = 0;
+    JSON_ARRAY_FOREACH(iter, flat_copy)
+    {
+        assert(iter.value == json_array_get(flat, iter.index));
+        count++;
+    }
+    assert(count == 2);
+    json_free(flat_copy);
+    json_free(flat);
+
+    // Keys come in insertion order, skipping removed ones
+    struct json *object = json_object();
+    char key[32];
+    for (int i = 0; i < 20; i++)
+    {
+        sprintf(key, "key%d", i);
+        json_object_set(object, key, json_number(i));
+    }
+    for (int i = 0; i < 20; i += 3)
+    {
+        sprintf(key, "key%d", i);
+        json_free(json_object_remove(object, key));
+    }
+    struct json_object_iter entry;
+    int expected = 0;
+    count = 0;
+    JSON_OBJECT_FOREACH(entry, object)
+    {
+        if (expected % 3 == 0)
+            expected++;
+        sprintf(key, "key%d", expected);
+        assert(strcmp(entry.key, key) == 0);
+        assert(entry.key_length == strlen(key));
+        assert(json_int_value(entry.value) == expected);
+        expected++;
+        count++;
+    }
+    assert(count == json_object_length(object));
+
+    // Keys containing NUL bytes are given with their length
+    struct json *binary = json_object();
+    json_object_set_n(binary, "a\0b", 3, json_true());
+    JSON_OBJECT_FOREACH(entry, binary)
+    {
+        assert(entry.key_length == 3);
+        assert(memcmp(entry.key, "a\0b", 3) == 0);
+    }
+    json_free(binary);
+
+    // Empty containers, other values and NULL yield nothing
+    struct json *empty = json_array();
+    struct json *string = json_string("not a container");
+    JSON_ARRAY_FOREACH(iter, empty)
+        assert(0);
+    JSON_ARRAY_FOREACH(iter, object)
+        assert(0);
+    JSON_ARRAY_FOREACH(iter, NULL)
+        assert(0);
+    JSON_OBJECT_FOREACH(entry, string)
+        assert(0);
+    JSON_OBJECT_FOREACH(entry, array)
+        assert(0);
+    json_free(empty);
+    json_free(string);
+
+    json_free(array);
+    json_free(object);
+    return 0;
+}
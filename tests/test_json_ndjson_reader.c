@@ -0,0 +1,134 @@
+#include "libjson/json.h"
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct failure_log
+{
+    int count;
+    long long offsets[8];
+    long long lines[8];
+    enum json_ndjson_failure reasons[8];
+};
+
+static void on_error(long long offset, long long line, enum json_ndjson_failure reason, const char *message, void *ctx)
+{
+    struct failure_log *log = ctx;
+    assert(message != NULL && strlen(message) > 0);
+    log->offsets[log->count] = offset;
+    log->lines[log->count] = line;
+    log->reasons[log->count] = reason;
+    log->count++;
+}
+
+// Allocations fail while set, to check that they are not reported as syntax
+// errors
+static int failing = 0;
+
+static void *failing_malloc(size_t size, void *ctx)
+{
+    (void)ctx;
+    return failing ? NULL : malloc(size);
+}
+
+static void *failing_realloc(void *ptr, size_t size, void *ctx)
+{
+    (void)ctx;
+    return failing ? NULL : realloc(ptr, size);
+}
+
+static void plain_free(void *ptr, void *ctx)
+{
+    (void)ctx;
+    free(ptr);
+}
+
+int main()
+{
+    json_set_allocator(failing_malloc, failing_realloc, plain_free, NULL);
+    const char *stream =
+        "{\"id\": 1}\n"
+        "{\"id\": 2, \"broken\": }\n"
+        "\n"
+        "{\"id\": 3} {\"id\": 4}\r\n"
+        "[\"unterminated\n"
+        "{\"id\": 5}";
+    FILE *in = fmemopen((void *)stream, strlen(stream), "r");
+    assert(in != NULL);
+
+    struct failure_log log = {0};
+    struct json_ndjson_reader *reader = json_ndjson_reader_new(in, NULL, on_error, &log);
+    assert(reader != NULL);
+
+    // Invalid records are skipped
+    struct json *record = json_ndjson_reader_next(reader);
+    assert(json_int_value(json_object_get(record, "id")) == 1);
+    json_free(record);
+    record = json_ndjson_reader_next(reader);
+    assert(json_int_value(json_object_get(record, "id")) == 5);
+    json_free(record);
+    assert(json_ndjson_reader_next(reader) == NULL);
+
+    // Failures were reported with their position
+    assert(log.count == 3);
+    assert(log.offsets[0] == 10 && log.lines[0] == 2);
+    assert(log.reasons[0] == JSON_NDJSON_SYNTAX);
+    assert(log.offsets[1] == 33 && log.lines[1] == 4);
+    assert(log.reasons[1] == JSON_NDJSON_TRAILING_DATA);
+    assert(log.lines[2] == 5);
+    assert(log.reasons[2] == JSON_NDJSON_SYNTAX);
+
+    // And counted
+    const struct json_ndjson_stats *stats = json_ndjson_reader_stats(reader);
+    assert(stats->records == 2);
+    assert(stats->failures == 3);
+    assert(stats->lines == 6);
+    assert(stats->bytes == (long long)strlen(stream));
+    assert(stats->failure_reasons[JSON_NDJSON_SYNTAX] == 2);
+    assert(stats->failure_reasons[JSON_NDJSON_TRAILING_DATA] == 1);
+    assert(stats->failure_reasons[JSON_NDJSON_OUT_OF_MEMORY] == 0);
+
+    json_ndjson_reader_free(reader);
+    fclose(in);
+
+    // The callback is optional
+    in = fmemopen((void *)stream, strlen(stream), "r");
+    reader = json_ndjson_reader_new(in, NULL, NULL, NULL);
+    int records = 0;
+    while ((record = json_ndjson_reader_next(reader)))
+    {
+        records++;
+        json_free(record);
+    }
+    assert(records == 2);
+    assert(json_ndjson_reader_error(reader) == NULL);
+    json_ndjson_reader_free(reader);
+    fclose(in);
+
+    // Allocation failures are told apart from syntax errors
+    const char *records_stream = "{\"id\": [1, \"two\"]}\n[\"three\"]\n";
+    in = fmemopen((void *)records_stream, strlen(records_stream), "r");
+    log.count = 0;
+    reader = json_ndjson_reader_new(in, NULL, on_error, &log);
+    failing = 1;
+    assert(json_ndjson_reader_next(reader) == NULL);
+    failing = 0;
+    assert(log.count == 2);
+    assert(log.reasons[0] == JSON_NDJSON_OUT_OF_MEMORY && log.reasons[1] == JSON_NDJSON_OUT_OF_MEMORY);
+    assert(json_ndjson_reader_stats(reader)->failure_reasons[JSON_NDJSON_SYNTAX] == 0);
+    assert(json_ndjson_reader_error(reader) == NULL);
+    json_ndjson_reader_free(reader);
+    fclose(in);
+
+    // So are read errors from the end of the stream
+    in = fopen("/dev/null", "w");
+    assert(in != NULL);
+    reader = json_ndjson_reader_new(in, NULL, NULL, NULL);
+    assert(json_ndjson_reader_next(reader) == NULL);
+    assert(json_ndjson_reader_error(reader) != NULL);
+    json_ndjson_reader_free(reader);
+    fclose(in);
+
+    return 0;
+}
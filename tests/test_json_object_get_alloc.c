@@ -0,0 +1,95 @@
+#include "libjson/json.h"
+#include <stdio.h>
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define THREADS 4
+#define KEYS 1000
+
+static long allocations = 0;
+
+static void *counting_malloc(size_t size, void *ctx)
+{
+    (void)ctx;
+    __atomic_fetch_add(&allocations, 1, __ATOMIC_RELAXED);
+    return malloc(size);
+}
+
+static void *counting_realloc(void *ptr, size_t size, void *ctx)
+{
+    (void)ctx;
+    __atomic_fetch_add(&allocations, 1, __ATOMIC_RELAXED);
+    return realloc(ptr, size);
+}
+
+static void plain_free(void *ptr, void *ctx)
+{
+    (void)ctx;
+    free(ptr);
+}
+
+static struct json *small;
+static struct json *large;
+static struct json_key key_a;
+
+// Looks every key up, including missing ones
+static void *lookup(void *arg)
+{
+    (void)arg;
+    char key[32];
+    for (int round = 0; round < 20; round++)
+    {
+        double number = 0;
+        assert(json_object_get_number(small, "b", &number) && number == 2);
+        assert(json_object_get_key_number(small, &key_a, &number) && number == 1);
+        assert(!json_object_get_number(small, "name", &number));
+        assert(!json_object_get_number(small, "missing", NULL));
+        assert(strcmp(json_string_borrow(json_object_get(small, "name")), "value") == 0);
+        assert(json_object_get(small, "missing") == NULL);
+        for (int i = 0; i < KEYS; i++)
+        {
+            sprintf(key, "key%d", i);
+            assert(json_object_get(large, key) != NULL);
+        }
+        assert(json_object_get_n(large, "key1\0x", 6) == NULL);
+    }
+    return NULL;
+}
+
+int main()
+{
+    json_set_allocator(counting_malloc, counting_realloc, plain_free, NULL);
+    char errbuf[1024];
+    small = json_read_string("{\"a\": 1, \"b\": 2, \"name\": \"value\"}", errbuf);
+    large = json_object();
+    char key[32];
+    for (int i = 0; i < KEYS; i++)
+    {
+        sprintf(key, "key%d", i);
+        json_object_set(large, key, json_string(key));
+    }
+    key_a = json_key_make("a");
+
+    // Lookups do not allocate, even of numbers nobody has read yet and from
+    // several threads at once
+    long before = allocations;
+    pthread_t threads[THREADS];
+    for (int i = 0; i < THREADS; i++)
+        assert(pthread_create(&threads[i], NULL, lookup, NULL) == 0);
+    for (int i = 0; i < THREADS; i++)
+        assert(pthread_join(threads[i], NULL) == 0);
+    assert(allocations == before);
+    lookup(NULL);
+    assert(allocations == before);
+
+    // Getting the node of a number still works, and creates it then
+    assert(json_int_value(json_object_get(small, "b")) == 2);
+    double number = 0;
+    assert(json_object_get_number(small, "b", &number) && number == 2);
+
+    json_free(small);
+    json_free(large);
+    return 0;
+}
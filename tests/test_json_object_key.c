@@ -0,0 +1,62 @@
+#include "libjson/json.h"
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+
+int main()
+{
+    char errbuf[1024];
+    struct json *event = json_read_string("{\"timestamp\": 1700000000, \"level\": \"info\"}", errbuf);
+
+    // Slices need not be NUL-terminated
+    const char *text = "timestamplevel";
+    struct json_key timestamp = json_key_make_n(text, 9);
+    struct json_key level = json_key_make_n(text + 9, 5);
+    struct json_key missing = json_key_make("missing");
+    assert(json_int_value(json_object_get_key(event, &timestamp)) == 1700000000);
+    assert(strcmp(json_string_borrow(json_object_get_key(event, &level)), "info") == 0);
+    assert(json_object_get_key(event, &missing) == NULL);
+    assert(json_object_get_key(NULL, &timestamp) == NULL);
+    assert(json_object_get_key(event, NULL) == NULL);
+
+    // Keys set by handle are the same as keys set by string, before and
+    // after the object is indexed
+    struct json *object = json_object();
+    char name[32];
+    struct json_key keys[100];
+    static char names[100][32];
+    for (int i = 0; i < 100; i++)
+    {
+        sprintf(names[i], "key%d", i);
+        keys[i] = json_key_make(names[i]);
+        if (i % 2)
+            json_object_set_key(object, &keys[i], json_number(i));
+        else
+            json_object_set(object, names[i], json_number(i));
+    }
+    assert(json_object_length(object) == 100);
+    for (int i = 0; i < 100; i++)
+    {
+        sprintf(name, "key%d", i);
+        assert(json_int_value(json_object_get(object, name)) == i);
+        assert(json_int_value(json_object_get_key(object, &keys[i])) == i);
+    }
+
+    // Replacing keeps a single key, and leaves the old value to the caller
+    struct json *old = json_object_get_key(object, &keys[7]);
+    json_object_set_key(object, &keys[7], json_string("seven"));
+    json_free(old);
+    assert(json_object_length(object) == 100);
+    assert(strcmp(json_string_borrow(json_object_get(object, "key7")), "seven") == 0);
+
+    // Keys containing NUL bytes
+    struct json_key binary = json_key_make_n("a\0b", 3);
+    json_object_set_key(event, &binary, json_true());
+    assert(json_object_get_n(event, "a\0b", 3) != NULL);
+    assert(json_object_get(event, "a") == NULL);
+    assert(json_object_get_key(event, &binary) == json_object_get_n(event, "a\0b", 3));
+
+    json_free(object);
+    json_free(event);
+    return 0;
+}
@@ -0,0 +1,52 @@
+#include "libjson/json.h"
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+int main()
+{
+    char errbuf[1024];
+
+    // Keys holding NUL bytes are distinct from their prefix
+    struct json *object = json_read_string("{\"a\\u0000b\": 1, \"a\": 2}", errbuf);
+    assert(json_error(errbuf) == NULL);
+    assert(json_object_length(object) == 2);
+    assert(json_int_value(json_object_get_n(object, "a\0b", 3)) == 1);
+    assert(json_int_value(json_object_get(object, "a")) == 2);
+    assert(json_object_get_n(object, "a\0c", 3) == NULL);
+
+    // They are written back escaped
+    char *text = NULL;
+    size_t size = 0;
+    FILE *out = open_memstream(&text, &size);
+    json_write(object, out);
+    fclose(out);
+    assert(strstr(text, "\"a\\u0000b\":1") != NULL);
+    free(text);
+
+    // And survive copies
+    struct json *copy = json_copy(object);
+    assert(json_int_value(json_object_get_n(copy, "a\0b", 3)) == 1);
+    json_free(json_object_remove_n(copy, "a\0b", 3));
+    assert(json_object_get_n(copy, "a\0b", 3) == NULL);
+    assert(json_object_length(copy) == 1);
+    json_free(copy);
+    json_free(object);
+
+    // Keys are not limited in length
+    size_t length = 5000;
+    char *key = malloc(length + 1);
+    memset(key, 'k', length);
+    key[length] = '\0';
+    object = json_object();
+    json_object_set(object, key, json_number(1));
+    key[length - 1] = 'x';
+    json_object_set(object, key, json_number(2));
+    assert(json_int_value(json_object_get(object, key)) == 2);
+    key[length - 1] = 'k';
+    assert(json_int_value(json_object_get(object, key)) == 1);
+    json_free(object);
+    free(key);
+    return 0;
+}
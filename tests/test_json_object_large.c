@@ -0,0 +1,78 @@
+#include "libjson/json.h"
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+int main()
+{
+    const int count = 100000;
+    char key[32];
+
+    // Lookups stay correct while the table grows
+    struct json *object = json_object();
+    for (int i = 0; i < count; i++)
+    {
+        sprintf(key, "key%d", i);
+        json_object_set(object, key, json_number(i));
+    }
+    assert(json_object_length(object) == count);
+    for (int i = 0; i < count; i++)
+    {
+        sprintf(key, "key%d", i);
+        assert(json_int_value(json_object_get(object, key)) == i);
+    }
+    assert(json_object_get(object, "missing") == NULL);
+
+    // Replacing a value keeps a single entry
+    struct json *old = json_object_get(object, "key7");
+    json_object_set(object, "key7", json_string("seven"));
+    json_free(old);
+    assert(json_object_length(object) == count);
+    assert(strcmp(json_string_borrow(json_object_get(object, "key7")), "seven") == 0);
+
+    // Removing most keys shrinks the table without losing the others
+    for (int i = 0; i < count; i++)
+    {
+        if (i % 100 == 0)
+            continue;
+        sprintf(key, "key%d", i);
+        json_free(json_object_remove(object, key));
+    }
+    assert(json_object_length(object) == count / 100);
+    for (int i = 0; i < count; i += 100)
+    {
+        sprintf(key, "key%d", i);
+        assert(json_int_value(json_object_get(object, key)) == i);
+    }
+    sprintf(key, "key%d", 1);
+    assert(json_object_get(object, key) == NULL);
+
+    // Copies and round trips hold every key
+    struct json *copy = json_copy(object);
+    assert(json_object_length(copy) == count / 100);
+    char *text = NULL;
+    size_t size = 0;
+    FILE *out = open_memstream(&text, &size);
+    json_write(copy, out);
+    fclose(out);
+    struct json *parsed = json_read_string(text, NULL);
+    assert(json_object_length(parsed) == count / 100);
+    assert(json_int_value(json_object_get(parsed, "key99900")) == 99900);
+
+    // Removing every key leaves an empty object that can be filled again
+    for (int i = 0; i < count; i += 100)
+    {
+        sprintf(key, "key%d", i);
+        json_free(json_object_remove(copy, key));
+    }
+    assert(json_object_length(copy) == 0);
+    json_object_set(copy, "again", json_true());
+    assert(json_object_get(copy, "again") == json_true());
+
+    free(text);
+    json_free(parsed);
+    json_free(copy);
+    json_free(object);
+    return 0;
+}
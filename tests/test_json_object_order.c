@@ -0,0 +1,64 @@
+#include "libjson/json.h"
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+static char *serialize(struct json *value)
+{
+    char *text = NULL;
+    size_t size = 0;
+    FILE *out = open_memstream(&text, &size);
+    json_write(value, out);
+    fclose(out);
+    return text;
+}
+
+int main()
+{
+    // Keys are written in document order
+    const char *small = "{\"zeta\":1,\"alpha\":2,\"mid\":3}";
+    struct json *object = json_read_string(small, NULL);
+    char *text = serialize(object);
+    assert(strcmp(text, small) == 0);
+    free(text);
+
+    // Replacing a value keeps its place, removed keys leave no gap
+    struct json *old = json_object_get(object, "alpha");
+    json_object_set(object, "alpha", json_number(20));
+    json_free(old);
+    json_free(json_object_remove(object, "zeta"));
+    json_object_set(object, "zeta", json_number(10));
+    text = serialize(object);
+    assert(strcmp(text, "{\"alpha\":20,\"mid\":3,\"zeta\":10}") == 0);
+    free(text);
+    json_free(object);
+
+    // Large objects keep the order through removals and copies
+    char key[32];
+    object = json_object();
+    for (int i = 999; i >= 0; i--)
+    {
+        sprintf(key, "k%d", i);
+        json_object_set(object, key, json_number(i));
+    }
+    for (int i = 0; i < 1000; i += 3)
+    {
+        sprintf(key, "k%d", i);
+        json_free(json_object_remove(object, key));
+    }
+    struct json *copy = json_copy(object);
+    text = serialize(copy);
+    char *reparsed_text = NULL;
+    struct json *reparsed = json_read_string(text, NULL);
+    reparsed_text = serialize(reparsed);
+    assert(strcmp(text, reparsed_text) == 0);
+    assert(strncmp(text, "{\"k998\":998,\"k997\":997,\"k995\":995,", 34) == 0);
+
+    free(reparsed_text);
+    free(text);
+    json_free(reparsed);
+    json_free(copy);
+    json_free(object);
+    return 0;
+}
@@ -0,0 +1,56 @@
+#include "libjson/json.h"
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void check_keys(struct json *object, int from, int to)
+{
+    char key[16];
+    assert(json_object_length(object) == to - from);
+    for (int i = 0; i < 20; i++)
+    {
+        sprintf(key, "k%d", i);
+        if (i >= from && i < to)
+            assert(json_int_value(json_object_get(object, key)) == i);
+        else
+            assert(json_object_get(object, key) == NULL);
+    }
+}
+
+int main()
+{
+    char key[16];
+
+    // Keys of the same length and first byte are told apart
+    struct json *object = json_object(
+        (struct json_key_value){"ab", json_number(1)},
+        (struct json_key_value){"ac", json_number(2)},
+        (struct json_key_value){"a", json_number(3)},
+        (struct json_key_value){"", json_number(4)});
+    assert(json_int_value(json_object_get(object, "ab")) == 1);
+    assert(json_int_value(json_object_get(object, "ac")) == 2);
+    assert(json_int_value(json_object_get(object, "a")) == 3);
+    assert(json_int_value(json_object_get(object, "")) == 4);
+    assert(json_object_get(object, "abc") == NULL);
+    json_free(object);
+
+    // Growing past the small layout and shrinking back keeps every key
+    object = json_object();
+    for (int i = 0; i < 20; i++)
+    {
+        sprintf(key, "k%d", i);
+        json_object_set(object, key, json_number(i));
+        check_keys(object, 0, i + 1);
+    }
+    for (int i = 0; i < 20; i++)
+    {
+        sprintf(key, "k%d", i);
+        json_free(json_object_remove(object, key));
+        check_keys(object, i + 1, 20);
+    }
+    json_object_set(object, "k0", json_number(0));
+    check_keys(object, 0, 1);
+    json_free(object);
+    return 0;
+}
@@ -0,0 +1,208 @@
+#include "libjson/json.h"
+#include "libjson/json_persistent.h"
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define VERSIONS 16
+
+static struct json_persistent *from(struct json *json)
+{
+    struct json_persistent *value = json_persistent_from(json);
+    json_free(json);
+    return value;
+}
+
+static struct json_persistent *number(int value)
+{
+    return from(json_number(value));
+}
+
+static int number_at(const struct json_persistent *array, int index)
+{
+    return json_int_value(json_persistent_scalar(json_persistent_array_get(array, index)));
+}
+
+static char *serialize(const struct json_persistent *value)
+{
+    char *data = NULL;
+    size_t size = 0;
+    FILE *out = open_memstream(&data, &size);
+    struct json *json = json_persistent_to_json(value);
+    json_write(json, out);
+    json_free(json);
+    fclose(out);
+    return data;
+}
+
+// Random pushes, sets and pops checked against a plain array, keeping some
+// versions to check that they do not change
+static void check_array(void)
+{
+    static int model[VERSIONS][60000];
+    int lengths[VERSIONS];
+    struct json_persistent *kept[VERSIONS];
+    static int expected[60000];
+    int length = 0;
+    struct json_persistent *array = json_persistent_array();
+
+    srand(42);
+    for (int step = 0; step < 60000; step++)
+    {
+        struct json_persistent *version;
+        int choice = rand() % 10;
+        if (choice < 7 || length == 0)
+        {
+            version = json_persistent_array_push(array, number(step));
+            expected[length++] = step;
+        }
+        else if (choice < 9)
+        {
+            int index = rand() % length;
+            version = json_persistent_array_set(array, index, number(-step));
+            expected[index] = -step;
+        }
+        else
+        {
+            version = json_persistent_array_pop(array);
+            length--;
+        }
+        assert(version != NULL);
+        json_persistent_free(array);
+        array = version;
+        assert(json_persistent_length(array) == length);
+
+        if (step % (60000 / VERSIONS) == 0 && step / (60000 / VERSIONS) < VERSIONS)
+        {
+            int slot = step / (60000 / VERSIONS);
+            kept[slot] = json_persistent_copy(array);
+            lengths[slot] = length;
+            memcpy(model[slot], expected, length * sizeof(int));
+        }
+    }
+    for (int i = 0; i < length; i++)
+        assert(number_at(array, i) == expected[i]);
+    for (int slot = 0; slot < VERSIONS; slot++)
+    {
+        assert(json_persistent_length(kept[slot]) == lengths[slot]);
+        for (int i = 0; i < lengths[slot]; i++)
+            assert(number_at(kept[slot], i) == model[slot][i]);
+        json_persistent_free(kept[slot]);
+    }
+
+    // Down to empty, through every level
+    while (length)
+    {
+        struct json_persistent *version = json_persistent_array_pop(array);
+        json_persistent_free(array);
+        array = version;
+        length--;
+        if (length % 1000 == 0 && length)
+            assert(number_at(array, length - 1) == expected[length - 1]);
+    }
+    assert(json_persistent_length(array) == 0);
+    assert(json_persistent_array_pop(array) == NULL);
+    assert(json_persistent_array_get(array, 0) == NULL);
+    json_persistent_free(array);
+}
+
+static void check_object(void)
+{
+    struct json_persistent *object = json_persistent_object();
+    struct json_persistent *half = NULL;
+    char key[32];
+    for (int i = 0; i < 5000; i++)
+    {
+        sprintf(key, "key%d", i);
+        struct json_persistent *version = json_persistent_object_set(object, key, number(i));
+        json_persistent_free(object);
+        object = version;
+        if (i == 2499)
+            half = json_persistent_copy(object);
+    }
+    assert(json_persistent_length(object) == 5000);
+    assert(json_persistent_length(half) == 2500);
+    assert(json_persistent_object_get(half, "key2500") == NULL);
+
+    // Replacing a value, in a new version only
+    struct json_persistent *replaced = json_persistent_object_set(object, "key7", number(-7));
+    assert(json_int_value(json_persistent_scalar(json_persistent_object_get(replaced, "key7"))) == -7);
+    assert(json_int_value(json_persistent_scalar(json_persistent_object_get(object, "key7"))) == 7);
+    assert(json_persistent_length(replaced) == 5000);
+
+    // Removing every other key
+    for (int i = 0; i < 5000; i += 2)
+    {
+        sprintf(key, "key%d", i);
+        struct json_persistent *version = json_persistent_object_remove(replaced, key);
+        json_persistent_free(replaced);
+        replaced = version;
+    }
+    assert(json_persistent_length(replaced) == 2500);
+    for (int i = 0; i < 5000; i++)
+    {
+        sprintf(key, "key%d", i);
+        struct json_persistent *value = json_persistent_object_get(replaced, key);
+        assert(i % 2 ? value != NULL : value == NULL);
+        assert(json_int_value(json_persistent_scalar(json_persistent_object_get(object, key))) == i);
+        if (i < 2500)
+            assert(json_int_value(json_persistent_scalar(json_persistent_object_get(half, key))) == i);
+    }
+    struct json_persistent *same = json_persistent_object_remove(replaced, "missing");
+    assert(same == replaced);
+    json_persistent_free(same);
+
+    // Keys are listed in insertion order
+    char *written = serialize(replaced);
+    assert(strncmp(written, "{\"key1\":1,\"key3\":3,\"key5\":5,\"key7\":-7,", 37) == 0);
+    free(written);
+    json_persistent_free(replaced);
+    json_persistent_free(half);
+    json_persistent_free(object);
+}
+
+int main()
+{
+    const char *text = "{\"zeta\":1,\"alpha\":[true,null,\"a string long enough for the heap\",{\"x\":2.5}],\"mid\":\"m\"}";
+    char errbuf[1024];
+    struct json *json = json_read_string(text, errbuf);
+    struct json_persistent *root = json_persistent_from(json);
+    json_free(json);
+    char *written = serialize(root);
+    assert(strcmp(written, text) == 0);
+    free(written);
+
+    // Nested updates return new versions of the path to the change
+    struct json_persistent *alpha = json_persistent_object_get(root, "alpha");
+    struct json_persistent *alpha2 = json_persistent_array_push(alpha, from(json_string("new")));
+    struct json_persistent *root2 = json_persistent_object_set(root, "alpha", alpha2);
+    struct json_persistent *root3 = json_persistent_object_set(root2, "added", json_persistent_object());
+    written = serialize(root3);
+    assert(strcmp(written, "{\"zeta\":1,\"alpha\":[true,null,\"a string long enough for the heap\",{\"x\":2.5},\"new\"],\"mid\":\"m\",\"added\":{}}") == 0);
+    free(written);
+    written = serialize(root);
+    assert(strcmp(written, text) == 0);
+    free(written);
+    assert(json_persistent_object_get(root2, "alpha") == json_persistent_object_get(root3, "alpha"));
+    json_persistent_free(root2);
+    json_persistent_free(root);
+
+    struct json_persistent *removed = json_persistent_object_remove(root3, "zeta");
+    json_persistent_free(root3);
+    written = serialize(removed);
+    assert(strcmp(written, "{\"alpha\":[true,null,\"a string long enough for the heap\",{\"x\":2.5},\"new\"],\"mid\":\"m\",\"added\":{}}") == 0);
+    free(written);
+    json_persistent_free(removed);
+
+    // Wrong types are refused
+    struct json_persistent *scalar = number(1);
+    assert(json_persistent_array_push(scalar, number(2)) == NULL);
+    assert(json_persistent_object_set(scalar, "k", number(2)) == NULL);
+    assert(json_persistent_scalar(scalar) != NULL);
+    json_persistent_free(scalar);
+
+    check_array();
+    check_object();
+    return 0;
+}
@@ -0,0 +1,55 @@
+#include "libjson/json.h"
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+int main()
+{
+    char errbuf[1024];
+    struct json_read_options options = {.lazy_numbers = 1};
+
+    // Numbers keep their literal text
+    struct json *array = json_read_string_opts("[1.10, -0, 2e3, 9007199254740993]", &options, errbuf);
+    assert(array != NULL);
+    assert(json_array_length(array) == 4);
+    assert(strcmp(json_number_text(json_array_get(array, 0)), "1.10") == 0);
+    assert(json_double_value(json_array_get(array, 0)) == 1.1);
+    assert(json_int_value(json_array_get(array, 2)) == 2000);
+    assert(json_int64_value(json_array_get(array, 3)) == 9007199254740993LL);
+
+    // Written back verbatim
+    char buffer[256] = {0};
+    FILE *out = fmemopen(buffer, sizeof(buffer), "w");
+    assert(out != NULL);
+    int bytes_written = json_write(array, out);
+    fclose(out);
+    assert(strcmp(buffer, "[1.10,-0,2e3,9007199254740993]") == 0);
+    assert(bytes_written == (int)strlen(buffer));
+
+    // Copies keep the literal text
+    struct json *copy = json_copy(array);
+    assert(strcmp(json_number_text(json_array_get(copy, 3)), "9007199254740993") == 0);
+    json_free(copy);
+    json_free(array);
+
+    // Default parsing converts immediately
+    struct json *eager = json_read_string("1.10", errbuf);
+    assert(eager != NULL);
+    assert(json_number_text(eager) == NULL);
+    assert(json_double_value(eager) == 1.1);
+    json_free(eager);
+
+    // Created numbers have no literal text
+    struct json *created = json_number(3);
+    assert(json_number_text(created) == NULL);
+    assert(json_int64_value(created) == 3);
+    json_free(created);
+
+    // Literals that are not valid JSON numbers are rejected
+    struct json *invalid = json_read_string_opts("1-2", &options, errbuf);
+    assert(invalid == NULL);
+    assert(strstr(errbuf, "Error parsing JSON") != NULL);
+
+    return 0;
+}
@@ -0,0 +1,57 @@
+#include "libjson/json.h"
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+int main()
+{
+    char errbuf[1024];
+    struct json_read_options options = {.lazy_strings = 1};
+
+    const char *input = "{\"plain\":\"hello\",\"escaped\":\"a\\\"b\\\\c\\u00e9\\n\",\"k\\u0065y\":[\"\\/\"]}";
+    struct json *object = json_read_string_opts(input, &options, errbuf);
+    assert(object != NULL);
+
+    // Keys are always decoded
+    assert(json_object_get(object, "key") != NULL);
+
+    // Strings are decoded on access
+    struct json *plain = json_object_get(object, "plain");
+    assert(strcmp(json_string_borrow(plain), "hello") == 0);
+
+    struct json *escaped = json_object_get(object, "escaped");
+    const char *value = json_string_value(escaped);
+    assert(strcmp(value, "a\"b\\c\xc3\xa9\n") == 0);
+    free((void *)value);
+    assert(strcmp(json_string_borrow(escaped), "a\"b\\c\xc3\xa9\n") == 0);
+    assert(json_string_borrow(escaped) == json_string_borrow(escaped));
+
+    // Written back exactly as they were read
+    char buffer[256] = {0};
+    FILE *out = fmemopen(buffer, sizeof(buffer), "w");
+    assert(out != NULL);
+    json_write(escaped, out);
+    fclose(out);
+    assert(strcmp(buffer, "\"a\\\"b\\\\c\\u00e9\\n\"") == 0);
+
+    // Copies keep both forms
+    struct json *copy = json_copy(json_array_get(json_object_get(object, "key"), 0));
+    assert(strcmp(json_string_borrow(copy), "/") == 0);
+    json_free(copy);
+    json_free(object);
+
+    // Default parsing decodes immediately, including surrogate pairs
+    struct json *eager = json_read_string("\"\\ud83d\\ude00\"", errbuf);
+    assert(eager != NULL);
+    assert(strcmp(json_string_borrow(eager), "\xf0\x9f\x98\x80") == 0);
+    json_free(eager);
+
+    // Invalid escapes and unterminated strings are still rejected
+    assert(json_read_string_opts("\"\\x\"", &options, errbuf) == NULL);
+    assert(json_read_string_opts("\"\\u12\"", &options, errbuf) == NULL);
+    assert(json_read_string_opts("\"open", &options, errbuf) == NULL);
+    assert(strstr(errbuf, "Error parsing JSON") != NULL);
+
+    return 0;
+}
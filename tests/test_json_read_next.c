@@ -0,0 +1,74 @@
+#include "libjson/json.h"
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+int main()
+{
+    char errbuf[1024];
+
+    // Concatenated, whitespace separated and RFC 7464 sequences
+    const char *stream = "{\"a\":1}{\"b\":2} 3\n\x1e[true]\n\x1e\"s\"\n";
+    FILE *in = fmemopen((void *)stream, strlen(stream), "r");
+    assert(in != NULL);
+
+    struct json_reader *reader = json_reader_new(in, NULL);
+    assert(reader != NULL);
+
+    struct json *value = json_reader_next(reader, errbuf);
+    assert(json_is_object(value) && json_object_get(value, "a") != NULL);
+    assert(json_reader_offset(reader) == 7);
+    json_free(value);
+
+    value = json_reader_next(reader, errbuf);
+    assert(json_is_object(value) && json_object_get(value, "b") != NULL);
+    assert(json_reader_offset(reader) == 14);
+    json_free(value);
+
+    value = json_reader_next(reader, errbuf);
+    assert(json_int_value(value) == 3);
+    assert(json_reader_offset(reader) == 16);
+    json_free(value);
+
+    value = json_reader_next(reader, errbuf);
+    assert(json_is_array(value) && json_array_get(value, 0) == json_true());
+    json_free(value);
+
+    value = json_reader_next(reader, errbuf);
+    assert(json_is_string(value) && strcmp(json_string_borrow(value), "s") == 0);
+    json_free(value);
+
+    // End of stream is not an error
+    assert(json_reader_next(reader, errbuf) == NULL);
+    assert(json_error(errbuf) == NULL);
+    assert(json_reader_offset(reader) == (long long)strlen(stream));
+    json_reader_free(reader);
+    fclose(in);
+
+    // Bytes after a value are left in the stream
+    const char *numbers = "12 34";
+    in = fmemopen((void *)numbers, strlen(numbers), "r");
+    value = json_read_next(in, errbuf);
+    assert(json_int_value(value) == 12);
+    json_free(value);
+    assert(fgetc(in) == ' ');
+    value = json_read_next(in, errbuf);
+    assert(json_int_value(value) == 34);
+    json_free(value);
+    assert(json_read_next(in, errbuf) == NULL);
+    assert(json_error(errbuf) == NULL);
+    fclose(in);
+
+    // Errors are reported
+    const char *invalid = "{} {\"a\" 1}";
+    in = fmemopen((void *)invalid, strlen(invalid), "r");
+    value = json_read_next(in, errbuf);
+    assert(json_is_object(value));
+    json_free(value);
+    assert(json_read_next(in, errbuf) == NULL);
+    assert(json_error(errbuf) != NULL);
+    fclose(in);
+
+    return 0;
+}
@@ -0,0 +1,97 @@
+#include "libjson/json.h"
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+int main()
+{
+    char errbuf[1024];
+
+    // Write a large array to iterate over
+    FILE *file = tmpfile();
+    assert(file != NULL);
+    const int count = 10000;
+    fprintf(file, " [\n");
+    for (int i = 0; i < count; i++)
+        fprintf(file, "%s{\"index\": %d, \"tags\": [\"a\", \"b\"]}\n", i ? "," : "", i);
+    fprintf(file, "]\n[[1, 2], [], [3]]");
+    rewind(file);
+
+    struct json_reader *reader = json_reader_new(file, NULL);
+    assert(reader != NULL);
+
+    // Elements come one at a time
+    assert(json_reader_enter_array(reader, errbuf));
+    assert(json_reader_depth(reader) == 1);
+    struct json *element;
+    int read = 0;
+    while ((element = json_reader_next(reader, errbuf)))
+    {
+        assert(json_int_value(json_object_get(element, "index")) == read);
+        assert(json_array_length(json_object_get(element, "tags")) == 2);
+        json_free(element);
+        read++;
+    }
+    assert(json_error(errbuf) == NULL);
+    assert(read == count);
+    assert(json_reader_depth(reader) == 0);
+
+    // Nested arrays can be entered as well
+    assert(json_reader_enter_array(reader, errbuf));
+    assert(json_reader_enter_array(reader, errbuf));
+    assert(json_reader_depth(reader) == 2);
+    element = json_reader_next(reader, errbuf);
+    assert(json_int_value(element) == 1);
+    json_free(element);
+    element = json_reader_next(reader, errbuf);
+    assert(json_int_value(element) == 2);
+    json_free(element);
+    assert(json_reader_next(reader, errbuf) == NULL);
+    assert(json_error(errbuf) == NULL);
+    assert(json_reader_depth(reader) == 1);
+
+    // Empty nested array
+    assert(json_reader_enter_array(reader, errbuf));
+    assert(json_reader_next(reader, errbuf) == NULL);
+    assert(json_error(errbuf) == NULL);
+
+    // Remaining element is read whole
+    element = json_reader_next(reader, errbuf);
+    assert(json_is_array(element) && json_array_length(element) == 1);
+    json_free(element);
+    assert(json_reader_next(reader, errbuf) == NULL);
+    assert(json_reader_depth(reader) == 0);
+
+    // End of stream
+    assert(json_reader_next(reader, errbuf) == NULL);
+    assert(json_error(errbuf) == NULL);
+    assert(!json_reader_enter_array(reader, errbuf));
+    json_reader_free(reader);
+    fclose(file);
+
+    // Errors inside the array are reported
+    const char *invalid = "[1, 2 3]";
+    file = fmemopen((void *)invalid, strlen(invalid), "r");
+    reader = json_reader_new(file, NULL);
+    assert(json_reader_enter_array(reader, errbuf));
+    element = json_reader_next(reader, errbuf);
+    json_free(element);
+    element = json_reader_next(reader, errbuf);
+    json_free(element);
+    assert(json_reader_next(reader, errbuf) == NULL);
+    assert(json_error(errbuf) != NULL);
+    json_reader_free(reader);
+    fclose(file);
+
+    // Only arrays can be entered
+    const char *object = "{}";
+    file = fmemopen((void *)object, strlen(object), "r");
+    reader = json_reader_new(file, NULL);
+    assert(!json_reader_enter_array(reader, errbuf));
+    assert(json_error(errbuf) != NULL);
+    json_reader_free(reader);
+    fclose(file);
+
+    return 0;
+}
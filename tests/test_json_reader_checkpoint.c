@@ -0,0 +1,93 @@
+#include "libjson/json.h"
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+int main()
+{
+    char errbuf[1024];
+    struct json_checkpoint checkpoint;
+    struct json *value;
+
+    // Newline-delimited records
+    FILE *file = tmpfile();
+    assert(file != NULL);
+    for (int i = 0; i < 10; i++)
+        fprintf(file, "{\"id\": %d}\n", i);
+    rewind(file);
+
+    struct json_reader *reader = json_reader_new(file, NULL);
+    for (int i = 0; i < 4; i++)
+        json_free(json_reader_next(reader, errbuf));
+    json_reader_checkpoint(reader, &checkpoint);
+    assert(checkpoint.offset == json_reader_offset(reader));
+    assert(checkpoint.depth == 0);
+    for (int i = 4; i < 7; i++)
+        json_free(json_reader_next(reader, errbuf));
+    json_reader_free(reader);
+
+    // A new reader resumes from the checkpoint
+    rewind(file);
+    reader = json_reader_new(file, NULL);
+    assert(json_reader_restore(reader, &checkpoint, errbuf));
+    for (int i = 4; i < 10; i++)
+    {
+        value = json_reader_next(reader, errbuf);
+        assert(json_int_value(json_object_get(value, "id")) == i);
+        json_free(value);
+    }
+    assert(json_reader_next(reader, errbuf) == NULL);
+    assert(json_error(errbuf) == NULL);
+    json_reader_free(reader);
+    fclose(file);
+
+    // Checkpoints inside an entered array keep the container stack
+    file = tmpfile();
+    fprintf(file, "[[0, 1, 2, 3], 4, 5]");
+    rewind(file);
+    reader = json_reader_new(file, NULL);
+    assert(json_reader_enter_array(reader, errbuf));
+    assert(json_reader_enter_array(reader, errbuf));
+    json_free(json_reader_next(reader, errbuf));
+    json_free(json_reader_next(reader, errbuf));
+    json_reader_checkpoint(reader, &checkpoint);
+    assert(checkpoint.depth == 2);
+    assert(checkpoint.expect_comma);
+    json_reader_free(reader);
+
+    rewind(file);
+    reader = json_reader_new(file, NULL);
+    assert(json_reader_restore(reader, &checkpoint, errbuf));
+    int expected = 2;
+    while ((value = json_reader_next(reader, errbuf)) || json_reader_depth(reader) > 0)
+    {
+        if (!value)
+        {
+            // End of the nested array
+            assert(json_error(errbuf) == NULL);
+            continue;
+        }
+        assert(json_int_value(value) == expected++);
+        json_free(value);
+    }
+    assert(json_error(errbuf) == NULL);
+    assert(expected == 6);
+    json_reader_free(reader);
+    fclose(file);
+
+    // Checkpoints can be built by hand, e.g. from a saved offset
+    const char *text = "1 2";
+    file = fmemopen((void *)text, strlen(text), "r");
+    reader = json_reader_new(file, NULL);
+    checkpoint.depth = 0;
+    checkpoint.offset = 2;
+    assert(json_reader_restore(reader, &checkpoint, errbuf));
+    value = json_reader_next(reader, errbuf);
+    assert(json_int_value(value) == 2);
+    json_free(value);
+    json_reader_free(reader);
+    fclose(file);
+
+    return 0;
+}
@@ -0,0 +1,198 @@
+#include "libjson/json.h"
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct events
+{
+    char log[256];
+    size_t string_length;
+    int chunks;
+    int stop_at_key;
+};
+
+static void record(struct events *events, const char *event)
+{
+    strcat(events->log, event);
+}
+
+static int on_null(void *ctx)
+{
+    record(ctx, "n");
+    return 1;
+}
+
+static int on_boolean(int value, void *ctx)
+{
+    record(ctx, value ? "t" : "f");
+    return 1;
+}
+
+static int on_number(const char *text, void *ctx)
+{
+    record(ctx, text);
+    return 1;
+}
+
+static int on_string_chunk(const char *chunk, size_t length, int last, void *ctx)
+{
+    struct events *events = ctx;
+    assert(length <= LIBJSON_SAX_CHUNK_SIZE);
+    for (size_t i = 0; i < length; i++)
+    {
+        // Long strings repeat "ab\n"
+        if (events->string_length > 16)
+            assert(chunk[i] == "ab\n"[(events->string_length + i) % 3]);
+    }
+    if (events->string_length + length <= 16)
+        strncat(events->log, chunk, length);
+    events->string_length += length;
+    events->chunks++;
+    if (last)
+        record(ctx, "$");
+    return 1;
+}
+
+static int on_key(const char *key, void *ctx)
+{
+    struct events *events = ctx;
+    record(ctx, key);
+    record(ctx, ":");
+    return !events->stop_at_key;
+}
+
+static int on_start_object(void *ctx)
+{
+    record(ctx, "{");
+    return 1;
+}
+
+static int on_end_object(void *ctx)
+{
+    record(ctx, "}");
+    return 1;
+}
+
+static int on_start_array(void *ctx)
+{
+    record(ctx, "[");
+    return 1;
+}
+
+static int on_end_array(void *ctx)
+{
+    record(ctx, "]");
+    return 1;
+}
+
+static const struct json_sax_handler handler = {
+    .null_value = on_null,
+    .boolean_value = on_boolean,
+    .number_value = on_number,
+    .string_chunk = on_string_chunk,
+    .key = on_key,
+    .start_object = on_start_object,
+    .end_object = on_end_object,
+    .start_array = on_start_array,
+    .end_array = on_end_array};
+
+struct collected
+{
+    char *data;
+    size_t length;
+};
+
+static int collect_chunk(const char *chunk, size_t length, int last, void *ctx)
+{
+    struct collected *collected = ctx;
+    (void)last;
+    assert(length <= LIBJSON_SAX_CHUNK_SIZE);
+    collected->data = realloc(collected->data, collected->length + length);
+    memcpy(collected->data + collected->length, chunk, length);
+    collected->length += length;
+    return 1;
+}
+
+static int read_events(const char *text, struct events *events, char *errbuf)
+{
+    FILE *in = fmemopen((void *)text, strlen(text), "r");
+    assert(in != NULL);
+    int result = json_sax_read(in, &handler, events, errbuf);
+    fclose(in);
+    return result;
+}
+
+int main()
+{
+    char errbuf[1024];
+    struct events events = {0};
+
+    // Events come in document order
+    assert(read_events("{\"a\\u0062\": [1.5, true, false, null, \"x\\ty\"], \"e\": {}, \"z\": []}", &events, errbuf));
+    assert(json_error(errbuf) == NULL);
+    assert(strcmp(events.log, "{ab:[1.5tfnx\ty$]e:{}z:[]}") == 0);
+
+    // Huge strings arrive in bounded chunks, unescaped
+    const int repeat = 100000;
+    FILE *file = tmpfile();
+    assert(file != NULL);
+    fputc('"', file);
+    for (int i = 0; i < repeat; i++)
+        fputs("a\\u0062\\n", file);
+    fputc('"', file);
+    rewind(file);
+    memset(&events, 0, sizeof(events));
+    events.string_length = 18; // check every byte, aligned on the pattern
+    assert(json_sax_read(file, &handler, &events, errbuf));
+    fclose(file);
+    assert(events.string_length - 18 == (size_t)repeat * 3);
+    assert(events.chunks > 1);
+
+    // A lone high surrogate held back at the end of a chunk, followed by
+    // another escape
+    const size_t padding = LIBJSON_SAX_CHUNK_SIZE - 4;
+    char *text = malloc(padding + 16);
+    text[0] = '"';
+    memset(text + 1, 'a', padding);
+    strcpy(text + 1 + padding, "\\ud800\\u4e00\"");
+    struct json_sax_handler collector = {.string_chunk = collect_chunk};
+    struct collected collected = {0};
+    file = fmemopen(text, strlen(text), "r");
+    assert(json_sax_read(file, &collector, &collected, errbuf));
+    fclose(file);
+    assert(collected.length == padding + 6);
+    assert(memcmp(collected.data + padding, "\xed\xa0\x80\xe4\xb8\x80", 6) == 0);
+    free(collected.data);
+    free(text);
+
+    // Callbacks are optional
+    struct json_sax_handler empty = {0};
+    file = tmpfile();
+    fputs("[\"skip\", {\"k\": 1}]", file);
+    rewind(file);
+    assert(json_sax_read(file, &empty, NULL, errbuf));
+    fclose(file);
+
+    // Callbacks can stop parsing
+    memset(&events, 0, sizeof(events));
+    events.stop_at_key = 1;
+    assert(!read_events("{\"stop\": 1}", &events, errbuf));
+    assert(strcmp(events.log, "{stop:") == 0);
+    assert(errbuf[0] != '\0');
+
+    // Invalid documents are reported
+    memset(&events, 0, sizeof(events));
+    assert(!read_events("[1, 2", &events, errbuf));
+    assert(strstr(errbuf, "Error parsing JSON") != NULL);
+    assert(!read_events("\"open", &events, errbuf));
+    assert(!read_events("\"\\q\"", &events, errbuf));
+    assert(!read_events("{1: 2}", &events, errbuf));
+    assert(!read_events("[1 \"two\"]", &events, errbuf));
+    assert(!read_events("[1 2]", &events, errbuf));
+    assert(!read_events("{\"a\" \"b\"}", &events, errbuf));
+    assert(!read_events("{\"a\": 1 \"b\"}", &events, errbuf));
+    assert(strstr(errbuf, "Expecting '}' or ','") != NULL);
+
+    return 0;
+}
@@ -0,0 +1,47 @@
+#include "libjson/json.h"
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void check_string(const char *value)
+{
+    struct json *node = json_string(value);
+    assert(json_is_string(node));
+    assert(strcmp(json_string_borrow(node), value) == 0);
+
+    // Copies share the node, which outlives the original
+    struct json *copy = json_copy(node);
+    json_free(node);
+    assert(strcmp(json_string_borrow(copy), value) == 0);
+
+    char *data = NULL;
+    size_t size = 0;
+    FILE *out = open_memstream(&data, &size);
+    assert(json_write(copy, out) == (int)strlen(value) + 2);
+    fclose(out);
+    assert(data[0] == '"' && strncmp(data + 1, value, strlen(value)) == 0);
+    free(data);
+
+    json_free(copy);
+}
+
+int main()
+{
+    // Around the size that fits in the node
+    check_string("");
+    check_string("a");
+    check_string("fifteen bytes!!");
+    check_string("sixteen bytes!!!");
+    check_string("a string that is much longer than the node");
+
+    // Parsed strings of both kinds, escaped or not
+    struct json *value = json_read_string("[\"id\", \"caf\\u00e9\", \"a longer string value here\", {\"k\": \"v\"}]", NULL);
+    assert(value != NULL);
+    assert(strcmp(json_string_borrow(json_array_get(value, 0)), "id") == 0);
+    assert(strcmp(json_string_borrow(json_array_get(value, 1)), "caf\xc3\xa9") == 0);
+    assert(strcmp(json_string_borrow(json_array_get(value, 2)), "a longer string value here") == 0);
+    assert(strcmp(json_string_borrow(json_object_get(json_array_get(value, 3), "k")), "v") == 0);
+    json_free(value);
+    return 0;
+}
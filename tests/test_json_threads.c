@@ -0,0 +1,59 @@
+#include "libjson/json.h"
+#include <stdio.h>
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define THREADS 4
+#define ROUNDS 200
+
+static const char *text = "{\"id\": 12, \"name\": \"a name long enough for the heap\", \"tags\": [\"x\", \"y\", {\"z\": [1, 2, 3]}]}";
+
+// Builds and frees values over and over, and hands some of them over to the
+// main thread to free
+static void *worker(void *arg)
+{
+    struct json **kept = arg;
+    char errbuf[1024];
+    for (int i = 0; i < ROUNDS; i++)
+    {
+        struct json *value = json_read_string(text, errbuf);
+        assert(value != NULL);
+        assert(json_int_value(json_object_get(value, "id")) == 12);
+        struct json *copy = json_copy(value);
+        json_free(value);
+        if (i % 10 == 0)
+            kept[i / 10] = copy;
+        else
+            json_free(copy);
+    }
+    return NULL;
+}
+
+int main()
+{
+    pthread_t threads[THREADS];
+    struct json *kept[THREADS][ROUNDS / 10];
+    for (int i = 0; i < THREADS; i++)
+        assert(pthread_create(&threads[i], NULL, worker, kept[i]) == 0);
+    for (int i = 0; i < THREADS; i++)
+        assert(pthread_join(threads[i], NULL) == 0);
+
+    // Values outlive the threads that built them
+    for (int i = 0; i < THREADS; i++)
+    {
+        for (int j = 0; j < ROUNDS / 10; j++)
+        {
+            struct json *tags = json_object_get(kept[i][j], "tags");
+            assert(json_array_length(tags) == 3);
+            assert(strcmp(json_string_borrow(json_array_get(tags, 1)), "y") == 0);
+            json_free(kept[i][j]);
+        }
+    }
+
+    // Objects freed by exited threads are reused
+    for (int i = 0; i < 1000; i++)
+        json_free(json_read_string(text, NULL));
+    return 0;
+}
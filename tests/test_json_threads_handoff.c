@@ -0,0 +1,83 @@
+#include "libjson/json.h"
+#include <stdio.h>
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ROUNDS 100
+#define VALUES 10000
+
+static long live = 0;
+
+static void *counting_malloc(size_t size, void *ctx)
+{
+    (void)ctx;
+    __atomic_fetch_add(&live, 1, __ATOMIC_RELAXED);
+    return malloc(size);
+}
+
+static void *counting_realloc(void *ptr, size_t size, void *ctx)
+{
+    (void)ctx;
+    if (!ptr)
+        __atomic_fetch_add(&live, 1, __ATOMIC_RELAXED);
+    return realloc(ptr, size);
+}
+
+static void counting_free(void *ptr, void *ctx)
+{
+    (void)ctx;
+    if (ptr)
+        __atomic_fetch_sub(&live, 1, __ATOMIC_RELAXED);
+    free(ptr);
+}
+
+static struct json *values[VALUES];
+static pthread_barrier_t built;
+static pthread_barrier_t freed;
+
+// Frees every value the main thread builds, for as long as it runs
+static void *consumer(void *arg)
+{
+    (void)arg;
+    for (int round = 0; round < ROUNDS; round++)
+    {
+        pthread_barrier_wait(&built);
+        for (int i = 0; i < VALUES; i++)
+            json_free(values[i]);
+        pthread_barrier_wait(&freed);
+    }
+    return NULL;
+}
+
+int main()
+{
+    json_set_allocator(counting_malloc, counting_realloc, counting_free, NULL);
+    assert(pthread_barrier_init(&built, NULL, 2) == 0);
+    assert(pthread_barrier_init(&freed, NULL, 2) == 0);
+    pthread_t thread;
+    assert(pthread_create(&thread, NULL, consumer, NULL) == 0);
+
+    // Memory freed by the consumer comes back to the producer, so that it
+    // stays the same from one round to the next
+    long after_first = 0;
+    for (int round = 0; round < ROUNDS; round++)
+    {
+        for (int i = 0; i < VALUES; i++)
+        {
+            values[i] = json_number(i);
+            assert(values[i] != NULL);
+        }
+        pthread_barrier_wait(&built);
+        pthread_barrier_wait(&freed);
+        if (round == 1)
+            after_first = live;
+    }
+    assert(live <= 2 * after_first);
+
+    assert(pthread_join(thread, NULL) == 0);
+    pthread_barrier_destroy(&built);
+    pthread_barrier_destroy(&freed);
+    return 0;
+}